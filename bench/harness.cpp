@@ -3,12 +3,14 @@
 //
 // Copyright 2016 whitequark
 //-----------------------------------------------------------------------------
+#include <random>
 #include "solvespace.h"
 
 static bool RunBenchmark(std::function<void()> setupFn,
                          std::function<bool()> benchFn,
                          std::function<void()> teardownFn,
-                         size_t minIter = 5, double minTime = 5.0) {
+                         size_t minIter = 5, double minTime = 5.0,
+                         double *timePerIter = NULL) {
     // Warmup
     setupFn();
     if(!benchFn()) {
@@ -37,6 +39,7 @@ static bool RunBenchmark(std::function<void()> setupFn,
     fprintf(stdout, "Time:       %.3f s\n", time);
     fprintf(stdout, "Per iter.:  %.3f s\n", time / (double)iter);
 
+    if(timePerIter != NULL) *timePerIter = time / (double)iter;
     return true;
 }
 
@@ -45,12 +48,17 @@ int main(int argc, char **argv) {
 
     std::string mode;
     Platform::Path filename;
-    if(args.size() == 3) {
+    std::vector<Platform::Path> filenames;
+    if(args.size() >= 3) {
         mode = args[1];
-        filename = Platform::Path::From(args[2]);
+        for(size_t i = 2; i < args.size(); i++) {
+            filenames.push_back(Platform::Path::From(args[i]));
+        }
+        filename = filenames[0];
     } else {
-        fprintf(stderr, "Usage: %s [mode] [filename]\n", args[0].c_str());
-        fprintf(stderr, "Mode can be one of: load.\n");
+        fprintf(stderr, "Usage: %s [mode] [filename...]\n", args[0].c_str());
+        fprintf(stderr, "Mode can be one of: load, solve, damped, dense, raycast, regen, meshbool, bsp.\n");
+        fprintf(stderr, "Only dense takes more than one file.\n");
         return 1;
     }
 
@@ -70,6 +78,365 @@ int main(int argc, char **argv) {
                 SK.Clear();
                 SS.Clear();
             });
+    } else if(mode == "solve") {
+        // Re-solve every group of an already loaded file, first with the
+        // independent subsystems solved one after another, then in parallel.
+        bool parallel = false, loaded = false;
+        auto setupFn = [&] {
+            SS.Init();
+            SS.solveInParallel = parallel;
+            loaded = SS.LoadFromFile(filename);
+            if(loaded) SS.AfterNewFile();
+        };
+        auto benchFn = [&] {
+            if(!loaded)
+                return false;
+            for(hGroup hg : SK.groupOrder) {
+                SS.SolveGroup(hg, /*andFindFree=*/false);
+            }
+            return true;
+        };
+        auto teardownFn = [] {
+            SK.Clear();
+            SS.Clear();
+        };
+
+        double serialTime, parallelTime;
+        fprintf(stdout, "Serial:\n");
+        result = RunBenchmark(setupFn, benchFn, teardownFn, 5, 5.0, &serialTime);
+        if(result) {
+            fprintf(stdout, "Parallel:\n");
+            parallel = true;
+            result = RunBenchmark(setupFn, benchFn, teardownFn, 5, 5.0, &parallelTime);
+        }
+        if(result) {
+            fprintf(stdout, "Speedup:    %.2fx\n", serialTime / parallelTime);
+        }
+    } else if(mode == "damped") {
+        // Solve every group of a file again from a perturbed starting point,
+        // first with plain Newton steps, then with damped ones.
+        bool damped = false, loaded = false;
+        int iterations = 0;
+        auto setupFn = [&] {
+            SS.Init();
+            SS.dampedSolver = damped;
+            loaded = SS.LoadFromFile(filename);
+            if(!loaded) return;
+            SS.AfterNewFile();
+            int i = 0;
+            for(Param &p : SK.param) {
+                p.val += 1e-2 * ((i++ % 7) - 3);
+            }
+        };
+        auto benchFn = [&] {
+            if(!loaded)
+                return false;
+            iterations = 0;
+            for(hGroup hg : SK.groupOrder) {
+                SS.SolveGroup(hg, /*andFindFree=*/false);
+                iterations += SK.GetGroup(hg)->solved.iterations;
+            }
+            return true;
+        };
+        auto teardownFn = [] {
+            SK.Clear();
+            SS.Clear();
+        };
+
+        fprintf(stdout, "Newton:\n");
+        result = RunBenchmark(setupFn, benchFn, teardownFn);
+        if(result) {
+            fprintf(stdout, "Steps:      %d\n", iterations);
+            fprintf(stdout, "Levenberg-Marquardt:\n");
+            damped = true;
+            result = RunBenchmark(setupFn, benchFn, teardownFn);
+        }
+        if(result) {
+            fprintf(stdout, "Steps:      %d\n", iterations);
+        }
+    } else if(mode == "dense") {
+        // Solve every group of each file, first with all the subsystems
+        // solved as sparse matrices, then with the small ones as dense.
+        bool sparse = false, loaded = false;
+        auto setupFn = [&] {
+            SS.Init();
+            SS.sys.sparseOnly = sparse;
+            loaded = SS.LoadFromFile(filename);
+            if(loaded) SS.AfterNewFile();
+        };
+        auto benchFn = [&] {
+            if(!loaded)
+                return false;
+            for(hGroup hg : SK.groupOrder) {
+                SS.SolveGroup(hg, /*andFindFree=*/false);
+            }
+            return true;
+        };
+        auto teardownFn = [] {
+            SK.Clear();
+            SS.Clear();
+        };
+
+        double sparseTotal = 0.0, denseTotal = 0.0;
+        for(const Platform::Path &f : filenames) {
+            filename = f;
+            double sparseTime, denseTime;
+            fprintf(stdout, "%s\n", f.raw.c_str());
+            fprintf(stdout, "Sparse:\n");
+            sparse = true;
+            result = RunBenchmark(setupFn, benchFn, teardownFn, 5, 1.0, &sparseTime);
+            if(!result) break;
+            fprintf(stdout, "Dense:\n");
+            sparse = false;
+            result = RunBenchmark(setupFn, benchFn, teardownFn, 5, 1.0, &denseTime);
+            if(!result) break;
+            fprintf(stdout, "Speedup:    %.2fx\n", sparseTime / denseTime);
+            sparseTotal += sparseTime;
+            denseTotal  += denseTime;
+        }
+        if(result && filenames.size() > 1) {
+            fprintf(stdout, "Overall speedup: %.2fx\n", sparseTotal / denseTotal);
+        }
+    } else if(mode == "raycast") {
+        // Intersect many short line segments with the solid model of the last
+        // group, first testing them against every surface of the shell, then
+        // through its bounding volume hierarchy and presplit surfaces.
+        bool indexed = false;
+        SShell *shell = NULL;
+        SS.Init();
+        if(SS.LoadFromFile(filename)) {
+            SS.AfterNewFile();
+            for(hGroup hg : SK.groupOrder) {
+                Group *g = SK.GetGroup(hg);
+                if(!g->runningShell.IsEmpty()) shell = &g->runningShell;
+            }
+        }
+
+        std::vector<Vector> lines;
+        if(shell != NULL) {
+            Vector max = Vector::From(VERY_NEGATIVE, VERY_NEGATIVE, VERY_NEGATIVE),
+                   min = Vector::From(VERY_POSITIVE, VERY_POSITIVE, VERY_POSITIVE);
+            for(SSurface &srf : shell->surface) {
+                Vector smax, smin;
+                srf.GetAxisAlignedBounding(&smax, &smin);
+                smax.MakeMaxMin(&max, &min);
+                smin.MakeMaxMin(&max, &min);
+            }
+            Vector size = max.Minus(min);
+            std::mt19937 gen(1);
+            std::uniform_real_distribution<double> dist(0.0, 1.0);
+            for(int i = 0; i < 10000; i++) {
+                Vector a = min.Plus(Vector::From(dist(gen) * size.x, dist(gen) * size.y,
+                                                 dist(gen) * size.z)),
+                       d = Vector::From(dist(gen) - 0.5, dist(gen) - 0.5, dist(gen) - 0.5);
+                lines.push_back(a);
+                lines.push_back(a.Plus(d.WithMagnitude(0.05 * size.Magnitude())));
+            }
+        }
+
+        int hits = 0;
+        auto setupFn = [&] {
+            if(shell == NULL) return;
+            if(indexed) {
+                shell->MakeBvhs();
+            } else {
+                shell->ClearBvhs();
+            }
+        };
+        auto benchFn = [&] {
+            if(shell == NULL)
+                return false;
+            hits = 0;
+            List<SInter> il = {};
+            for(size_t i = 0; i < lines.size(); i += 2) {
+                shell->AllPointsIntersecting(lines[i], lines[i + 1], &il,
+                    /*asSegment=*/true, /*trimmed=*/true, /*inclTangent=*/false);
+                hits += il.n;
+                il.Clear();
+            }
+            return true;
+        };
+        auto teardownFn = [] {};
+
+        double linearTime, indexedTime;
+        fprintf(stdout, "Linear:\n");
+        result = RunBenchmark(setupFn, benchFn, teardownFn, 5, 1.0, &linearTime);
+        if(result) {
+            fprintf(stdout, "Hits:       %d\n", hits);
+            fprintf(stdout, "Indexed:\n");
+            indexed = true;
+            result = RunBenchmark(setupFn, benchFn, teardownFn, 5, 1.0, &indexedTime);
+        }
+        if(result) {
+            fprintf(stdout, "Hits:       %d\n", hits);
+            fprintf(stdout, "Speedup:    %.2fx\n", linearTime / indexedTime);
+        }
+        SK.Clear();
+        SS.Clear();
+    } else if(mode == "regen") {
+        // Regenerate every group of an already loaded file, as if something
+        // in the first group had changed but none of the geometry had; first
+        // with the Boolean results forgotten each time, then remembered, and
+        // then with only the intersection curves between surfaces remembered.
+        enum { COLD, WARM, CURVES } pass = COLD;
+        bool loaded = false;
+        SS.Init();
+        loaded = SS.LoadFromFile(filename);
+        if(loaded) SS.AfterNewFile();
+
+        auto setupFn = [&] {
+            if(pass != WARM) {
+                SS.shellBooleans.Clear();
+                SS.meshBooleans.Clear();
+            }
+            if(pass == COLD) {
+                SS.intersections.Clear();
+            }
+        };
+        auto benchFn = [&] {
+            if(!loaded)
+                return false;
+            SS.GenerateAll(SolveSpaceUI::Generate::ALL);
+            return true;
+        };
+        auto teardownFn = [] {};
+
+        double coldTime, warmTime, curvesTime;
+        fprintf(stdout, "Cold:\n");
+        result = RunBenchmark(setupFn, benchFn, teardownFn, 5, 1.0, &coldTime);
+        if(result) {
+            fprintf(stdout, "Warm:\n");
+            pass = WARM;
+            SS.shellBooleans.hits = SS.shellBooleans.misses = 0;
+            SS.meshBooleans.hits  = SS.meshBooleans.misses  = 0;
+            result = RunBenchmark(setupFn, benchFn, teardownFn, 5, 1.0, &warmTime);
+        }
+        if(result) {
+            fprintf(stdout, "Hit rate:   %.1f%% (shells), %.1f%% (meshes)\n",
+                    100.0 * SS.shellBooleans.HitRate(), 100.0 * SS.meshBooleans.HitRate());
+            fprintf(stdout, "Speedup:    %.2fx\n", coldTime / warmTime);
+
+            fprintf(stdout, "Curves only:\n");
+            pass = CURVES;
+            SS.intersections.hits = SS.intersections.misses = 0;
+            result = RunBenchmark(setupFn, benchFn, teardownFn, 5, 1.0, &curvesTime);
+        }
+        if(result) {
+            fprintf(stdout, "Hit rate:   %.1f%% (intersections)\n",
+                    100.0 * SS.intersections.HitRate());
+            fprintf(stdout, "Speedup:    %.2fx\n", coldTime / curvesTime);
+        }
+        SK.Clear();
+        SS.Clear();
+    } else if(mode == "meshbool") {
+        // Regenerate every group of a file whose solids are meshes (e.g. linked
+        // STL parts, or groups forced to mesh), combining them first with BSP
+        // trees and then by splitting the intersecting triangles directly.
+        Group::MeshBoolean how = Group::MeshBoolean::BSP;
+        bool loaded = false;
+        SS.Init();
+        loaded = SS.LoadFromFile(filename);
+        if(loaded) SS.AfterNewFile();
+
+        SMesh *mesh = NULL;
+        auto setupFn = [&] {
+            for(Group &g : SK.group) {
+                g.meshBoolean = how;
+            }
+            SS.meshBooleans.Clear();
+        };
+        auto benchFn = [&] {
+            if(!loaded)
+                return false;
+            SS.GenerateAll(SolveSpaceUI::Generate::ALL);
+            for(hGroup hg : SK.groupOrder) {
+                Group *g = SK.GetGroup(hg);
+                if(!g->runningMesh.IsEmpty()) mesh = &g->runningMesh;
+            }
+            return true;
+        };
+        auto teardownFn = [] {};
+        auto reportFn = [&] {
+            if(mesh == NULL) return;
+            SEdgeList naked = {};
+            SMeshBvh bvh = {};
+            bvh.MakeFromCopyOf(mesh);
+            bvh.MakeCertainEdgesInto(&naked, EdgeKind::NAKED_OR_SELF_INTER,
+                                     /*coplanarIsInter=*/false, NULL, NULL);
+            fprintf(stdout, "Triangles:  %d\n", mesh->l.n);
+            fprintf(stdout, "Volume:     %.4f\n", mesh->CalculateVolume());
+            fprintf(stdout, "Naked:      %d\n", naked.l.n);
+            bvh.Clear();
+            naked.Clear();
+        };
+
+        double bspTime, indexedTime;
+        fprintf(stdout, "BSP:\n");
+        result = RunBenchmark(setupFn, benchFn, teardownFn, 5, 1.0, &bspTime);
+        if(result) {
+            reportFn();
+            fprintf(stdout, "Indexed:\n");
+            how = Group::MeshBoolean::INDEXED;
+            result = RunBenchmark(setupFn, benchFn, teardownFn, 5, 1.0, &indexedTime);
+        }
+        if(result) {
+            reportFn();
+            fprintf(stdout, "Speedup:    %.2fx\n", bspTime / indexedTime);
+        }
+        SK.Clear();
+        SS.Clear();
+    } else if(mode == "bsp") {
+        // Build a BSP tree of the mesh of the last group and sort that mesh
+        // in paint order through it, as the 2d export does; first with the
+        // triangles inserted one by one, then with the tree built all at once.
+        bool bulk = false;
+        SMesh *mesh = NULL;
+        SS.Init();
+        if(SS.LoadFromFile(filename)) {
+            SS.AfterNewFile();
+            for(hGroup hg : SK.groupOrder) {
+                Group *g = SK.GetGroup(hg);
+                g->GenerateDisplayItems();
+                if(!g->displayMesh.IsEmpty()) mesh = &g->displayMesh;
+            }
+        }
+
+        SBsp3::Stats stats = {};
+        auto setupFn = [] {};
+        auto benchFn = [&] {
+            if(mesh == NULL)
+                return false;
+            SBsp3 *bsp = bulk ? SBsp3::FromMesh(mesh) : SBsp3::FromMeshIncrementally(mesh);
+            SMesh sorted = {};
+            bsp->GenerateInPaintOrder(&sorted);
+            bsp->GetStats(&stats);
+            sorted.Clear();
+            return true;
+        };
+        auto teardownFn = [] {
+            FreeAllTemporary();
+        };
+        auto reportFn = [&] {
+            fprintf(stdout, "Planes:     %d\n", stats.planes);
+            fprintf(stdout, "Fragments:  %d (of %d)\n", stats.fragments, mesh->l.n);
+            fprintf(stdout, "Depth:      %d (mean %.1f)\n", stats.depth, stats.meanDepth);
+        };
+
+        double incrementalTime, bulkTime;
+        fprintf(stdout, "Incremental:\n");
+        result = RunBenchmark(setupFn, benchFn, teardownFn, 5, 1.0, &incrementalTime);
+        if(result) {
+            reportFn();
+            fprintf(stdout, "Bulk:\n");
+            bulk = true;
+            result = RunBenchmark(setupFn, benchFn, teardownFn, 5, 1.0, &bulkTime);
+        }
+        if(result) {
+            reportFn();
+            fprintf(stdout, "Speedup:    %.2fx\n", incrementalTime / bulkTime);
+        }
+        SK.Clear();
+        SS.Clear();
     } else {
         fprintf(stderr, "Unknown mode \"%s\"\n", mode.c_str());
     }
@@ -198,6 +198,25 @@ typedef struct {
 
 DLL void Slvs_Solve(Slvs_System *sys, Slvs_hGroup hg);
 
+/* Slvs_Solve() works in some global state, so it can only be called from
+ * one thread at a time. To solve many systems, create a context instead,
+ * which solves them on up to the given number of threads (or on as many
+ * as there are processors, if that's zero). Each system in sys[0] ...
+ * sys[count - 1] is solved for the group hg, exactly as Slvs_Solve()
+ * would; they are independent, and may share no arrays that get written.
+ *
+ * A context keeps its threads and the solver's working memory from one
+ * batch to the next, so it's fastest to make one and use it for all the
+ * batches. It may be
+ * used by only one thread at a time, but different contexts may be used
+ * at the same time. */
+typedef struct Slvs_Context Slvs_Context;
+
+DLL Slvs_Context *Slvs_CreateContext(int threads);
+DLL void Slvs_SolveBatch(Slvs_Context *ctx, Slvs_System *sys, int count,
+                         Slvs_hGroup hg);
+DLL void Slvs_DestroyContext(Slvs_Context *ctx);
+
 
 /* Our base coordinate system has basis vectors
  *     (1, 0, 0)  (0, 1, 0)  (0, 0, 1)
@@ -11,7 +11,9 @@
 SBsp2 *SBsp2::Alloc() { return (SBsp2 *)AllocTemporary(sizeof(SBsp2)); }
 SBsp3 *SBsp3::Alloc() { return (SBsp3 *)AllocTemporary(sizeof(SBsp3)); }
 
-SBsp3 *SBsp3::FromMesh(const SMesh *m) {
+// The builder that FromMesh() replaced, which inserts a shuffled copy of the
+// triangles one at a time; the benchmark and the tests compare against it.
+SBsp3 *SBsp3::FromMeshIncrementally(const SMesh *m) {
     SMesh mc = {};
     for(auto const &elt : m->l) { mc.AddTriangle(&elt); }
 
@@ -38,6 +40,24 @@ Vector SBsp3::IntersectionWith(Vector a, Vector b) const {
     return (a.ScaledBy(db/dab)).Plus(b.ScaledBy(-da/dab));
 }
 
+//-----------------------------------------------------------------------------
+// Whether a point is outside (POS) or inside (NEG) the closed mesh that the
+// BSP was built from. The point mustn't be on a face of the mesh; then, if it's
+// on a splitting plane, it's on the same side of the surface either way.
+//-----------------------------------------------------------------------------
+BspClass SBsp3::ClassifyPoint(Vector p) const {
+    const SBsp3 *node = this;
+    while(true) {
+        if(p.Dot(node->n) - node->d < 0) {
+            if(!node->neg) return BspClass::NEG;
+            node = node->neg;
+        } else {
+            if(!node->pos) return BspClass::POS;
+            node = node->pos;
+        }
+    }
+}
+
 void SBsp3::InsertInPlane(bool pos2, STriangle *tr, SMesh *m) {
     Vector tc = ((tr->a).Plus(tr->b).Plus(tr->c)).ScaledBy(1.0/3);
 
@@ -507,6 +527,184 @@ void SBsp3::Insert(STriangle *tr, SMesh *instead) {
     }
 }
 
+//-----------------------------------------------------------------------------
+// Build the tree from all of the triangles at once, instead of inserting them
+// one by one. At each node we try the planes of a few of the triangles that
+// reach it, and split on the one that cuts the fewest while dividing the rest
+// most evenly, so the depth and the number of fragments don't depend on the
+// order of the mesh. The nodes are built in a vector, and then copied into a
+// single block.
+//-----------------------------------------------------------------------------
+class BspBuilder {
+public:
+    // Planes tried at each node, and triangles they are tried against
+    static const size_t CANDIDATES = 16;
+    static const size_t SAMPLES    = 256;
+    // How many triangles of imbalance a split is worth
+    static constexpr double SPLIT_COST = 4.0;
+
+    struct Link {
+        int pos;
+        int neg;
+        int more;
+    };
+    std::vector<SBsp3>  node;
+    std::vector<Link>   link;
+
+    int AddNode(Vector n, double d, const STriangle &tr) {
+        SBsp3 bsp = {};
+        bsp.n   = n;
+        bsp.d   = d;
+        bsp.tri = tr;
+        node.push_back(bsp);
+        link.push_back({ -1, -1, -1 });
+        return (int)node.size() - 1;
+    }
+
+    static size_t ChooseSplitter(const std::vector<STriangle> &tris) {
+        size_t n = tris.size();
+        size_t step   = std::max((size_t)1, n / CANDIDATES),
+               sample = std::max((size_t)1, n / SAMPLES);
+
+        size_t best = 0;
+        double bestCost = VERY_POSITIVE;
+        for(size_t i = 0; i < n; i += step) {
+            Vector tn = tris[i].Normal();
+            // A sliver's plane isn't well defined, so don't cut anything on it.
+            if(tn.Magnitude() < LENGTH_EPS) continue;
+            tn = tn.WithMagnitude(1);
+            double td = (tris[i].a).Dot(tn);
+
+            int posc = 0, negc = 0, splitc = 0;
+            for(size_t j = 0; j < n; j += sample) {
+                const STriangle &tr = tris[j];
+                double dt[3] = { (tr.a).Dot(tn) - td, (tr.b).Dot(tn) - td,
+                                 (tr.c).Dot(tn) - td };
+                bool pos = false, neg = false;
+                for(double dv : dt) {
+                    if(dv >  LENGTH_EPS) pos = true;
+                    if(dv < -LENGTH_EPS) neg = true;
+                }
+                if(pos && neg) {
+                    splitc++;
+                } else if(pos) {
+                    posc++;
+                } else if(neg) {
+                    negc++;
+                }
+            }
+
+            double cost = SPLIT_COST * splitc + fabs((double)(posc - negc));
+            if(cost < bestCost) {
+                best = i;
+                bestCost = cost;
+            }
+        }
+        if(bestCost < VERY_POSITIVE) return best;
+
+        // Every candidate was a sliver, so take any triangle that isn't; or
+        // if they all are, then it doesn't matter which.
+        for(size_t i = 0; i < n; i++) {
+            if(tris[i].Normal().Magnitude() >= LENGTH_EPS) return i;
+        }
+        return 0;
+    }
+
+    // As SBsp3::Insert(), but only against this node; what would go further
+    // down is gathered for its children instead.
+    static void Partition(SBsp3 *bsp, STriangle *tr, std::vector<STriangle> *pos,
+                          std::vector<STriangle> *neg, std::vector<STriangle> *on) {
+        BspUtil *u = BspUtil::Alloc();
+        u->ClassifyTriangle(tr, bsp);
+
+        if(u->onc == 3) {
+            on->push_back(*tr);
+            return;
+        }
+
+        if(u->posc == 0 || u->negc == 0) {
+            if(u->onc == 2) {
+                u->ProcessEdgeInsert();
+            }
+            (u->posc > 0 ? pos : neg)->push_back(*tr);
+            return;
+        }
+
+        if(u->posc == 1 && u->negc == 1 && u->onc == 1) {
+            if(u->SplitIntoTwoTriangles(/*insertEdge=*/true)) {
+                pos->push_back(*(u->btri));
+                neg->push_back(*(u->ctri));
+            } else {
+                pos->push_back(*(u->ctri));
+                neg->push_back(*(u->btri));
+            }
+            return;
+        }
+
+        std::vector<STriangle> *quad, *alone;
+        if(u->SplitIntoTwoPieces(/*insertEdge=*/true)) {
+            quad = pos; alone = neg;
+        } else {
+            quad = neg; alone = pos;
+        }
+        alone->push_back(*(u->btri));
+        quad->push_back(STriangle::From(tr->meta, u->vpos[0], u->vpos[1], u->vpos[2]));
+        quad->push_back(STriangle::From(tr->meta, u->vpos[0], u->vpos[2], u->vpos[3]));
+    }
+
+    int Build(std::vector<STriangle> *tris) {
+        if(tris->empty()) return -1;
+
+        size_t splitter = ChooseSplitter(*tris);
+        const STriangle &st = (*tris)[splitter];
+        Vector n = (st.Normal()).WithMagnitude(1);
+        int i = AddNode(n, (st.a).Dot(n), st);
+
+        std::vector<STriangle> pos, neg, on;
+        for(size_t j = 0; j < tris->size(); j++) {
+            if(j == splitter) continue;
+            Partition(&node[i], &(*tris)[j], &pos, &neg, &on);
+        }
+        std::vector<STriangle>().swap(*tris);
+
+        int last = i;
+        for(const STriangle &tr : on) {
+            int j = AddNode(node[i].n, node[i].d, tr);
+            link[last].more = j;
+            last = j;
+        }
+
+        int p = Build(&pos);
+        link[i].pos = p;
+        int q = Build(&neg);
+        link[i].neg = q;
+        return i;
+    }
+
+    SBsp3 *MakePool() const {
+        if(node.empty()) return NULL;
+
+        SBsp3 *pool = (SBsp3 *)AllocTemporary(sizeof(SBsp3) * node.size());
+        for(size_t i = 0; i < node.size(); i++) {
+            pool[i] = node[i];
+            pool[i].pos  = (link[i].pos  >= 0) ? &pool[link[i].pos]  : NULL;
+            pool[i].neg  = (link[i].neg  >= 0) ? &pool[link[i].neg]  : NULL;
+            pool[i].more = (link[i].more >= 0) ? &pool[link[i].more] : NULL;
+        }
+        return pool;
+    }
+};
+
+SBsp3 *SBsp3::FromMesh(const SMesh *m) {
+    std::vector<STriangle> tris(m->l.begin(), m->l.end());
+
+    BspBuilder builder;
+    builder.node.reserve(2 * tris.size());
+    builder.link.reserve(2 * tris.size());
+    builder.Build(&tris);
+    return builder.MakePool();
+}
+
 void SBsp3::GenerateInPaintOrder(SMesh *m) const {
     // Doesn't matter which branch we take if the normal has zero z
     // component, so don't need a separate case for that.
@@ -529,6 +727,28 @@ void SBsp3::GenerateInPaintOrder(SMesh *m) const {
     }
 }
 
+void SBsp3::GetStats(Stats *stats, int depth) const {
+    if(depth == 1) {
+        *stats = {};
+    }
+    stats->planes++;
+    stats->depth = std::max(stats->depth, depth);
+
+    const SBsp3 *flip = this;
+    while(flip) {
+        stats->fragments++;
+        stats->meanDepth += depth;
+        flip = flip->more;
+    }
+
+    if(pos) pos->GetStats(stats, depth + 1);
+    if(neg) neg->GetStats(stats, depth + 1);
+
+    if(depth == 1) {
+        stats->meanDepth /= stats->fragments;
+    }
+}
+
 /////////////////////////////////
 
 Vector SBsp2::IntersectionWith(Vector a, Vector b) const {
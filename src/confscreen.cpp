@@ -112,6 +112,21 @@ void TextWindow::ScreenChangeAutomaticLineConstraints(int link, uint32_t v) {
     SS.GW.Invalidate();
 }
 
+void TextWindow::ScreenChangeSolveInParallel(int link, uint32_t v) {
+    SS.solveInParallel = !SS.solveInParallel;
+    SS.GW.Invalidate();
+}
+
+void TextWindow::ScreenChangeReverseModeJacobian(int link, uint32_t v) {
+    SS.reverseModeJacobian = !SS.reverseModeJacobian;
+    SS.GenerateAll(SolveSpaceUI::Generate::ALL);
+}
+
+void TextWindow::ScreenChangeDampedSolver(int link, uint32_t v) {
+    SS.dampedSolver = !SS.dampedSolver;
+    SS.GenerateAll(SolveSpaceUI::Generate::ALL);
+}
+
 void TextWindow::ScreenChangeShadedTriangles(int link, uint32_t v) {
     SS.exportShadedTriangles = !SS.exportShadedTriangles;
     SS.GW.Invalidate();
@@ -338,6 +353,15 @@ void TextWindow::ShowConfiguration() {
     Printf(false, "  %Fd%f%Ll%s  edit newly added dimensions%E",
         &ScreenChangeImmediatelyEditDimension,
         SS.immediatelyEditDimension ? CHECK_TRUE : CHECK_FALSE);
+    Printf(false, "  %Fd%f%Ll%s  solve independent subsystems in parallel%E",
+        &ScreenChangeSolveInParallel,
+        SS.solveInParallel ? CHECK_TRUE : CHECK_FALSE);
+    Printf(false, "  %Fd%f%Ll%s  differentiate constraints in reverse mode%E",
+        &ScreenChangeReverseModeJacobian,
+        SS.reverseModeJacobian ? CHECK_TRUE : CHECK_FALSE);
+    Printf(false, "  %Fd%f%Ll%s  damp solver steps (Levenberg-Marquardt)%E",
+        &ScreenChangeDampedSolver,
+        SS.dampedSolver ? CHECK_TRUE : CHECK_FALSE);
     Printf(false, "");
     Printf(false, "%Ft autosave interval (in minutes)%E");
     Printf(false, "%Ba   %d %Fl%Ll%f[change]%E",
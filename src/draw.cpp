@@ -674,9 +674,9 @@ void GraphicsWindow::DrawEntities(Canvas *canvas, bool persistent) {
     }
 }
 
-void GraphicsWindow::DrawPersistent(Canvas *canvas) {
+void GraphicsWindow::DrawPersistent(Canvas *canvas, bool preview) {
     // Draw the active group; this does stuff like the mesh and edges.
-    SK.GetGroup(activeGroup)->Draw(canvas);
+    SK.GetGroup(activeGroup)->Draw(canvas, preview);
 
     // Now draw the entities that don't change with viewport.
     DrawEntities(canvas, /*persistent=*/true);
@@ -692,7 +692,7 @@ void GraphicsWindow::DrawPersistent(Canvas *canvas) {
     }
 }
 
-void GraphicsWindow::Draw(Canvas *canvas) {
+void GraphicsWindow::Draw(Canvas *canvas, bool preview) {
     const Camera &camera = canvas->GetCamera();
 
     // Nasty case when we're reloading the linked files; could be that
@@ -709,13 +709,13 @@ void GraphicsWindow::Draw(Canvas *canvas) {
             persistentDirty = false;
 
             persistentCanvas->Clear();
-            DrawPersistent(&*persistentCanvas);
+            DrawPersistent(&*persistentCanvas, preview);
             persistentCanvas->Finalize();
         }
 
         persistentCanvas->Draw();
     } else {
-        DrawPersistent(canvas);
+        DrawPersistent(canvas, preview);
     }
 
     // Draw the entities that do change with viewport.
@@ -881,8 +881,9 @@ void GraphicsWindow::Paint() {
     canvas->SetCamera(camera);
     canvas->StartFrame();
 
-    // Draw the 3d objects.
-    Draw(canvas.get());
+    // Draw the 3d objects; while the user is working, a coarse solid model
+    // right away is better than a fine one later.
+    Draw(canvas.get(), /*preview=*/true);
     canvas->FlushFrame();
 
     // Draw the 2d UI overlay.
@@ -210,6 +210,110 @@ struct VectorPred {
     bool operator()(Vector a, Vector b) const;
 };
 
+// A 64-bit FNV-1a hash of some values, added one after another; so that we
+// can tell cheaply (if not quite certainly) that two shells or meshes are
+// exactly the same.
+class ContentHasher {
+public:
+    uint64_t    value = 14695981039346656037ull;
+
+    void Add(const void *data, size_t size);
+    void Add(uint32_t v) { Add(&v, sizeof(v)); }
+    void Add(double v)   { if(EXACT(v == 0.0)) v = 0.0; Add(&v, sizeof(v)); }
+    void Add(Vector v)   { Add(v.x); Add(v.y); Add(v.z); }
+};
+
+// Values kept across regenerations, by key. An entry that no regeneration
+// has used for MAX_AGE generations gets forgotten; and then, if the values'
+// Size() adds up to more than MAX_SIZE, so do the least recently used. A
+// Value needs Clear() and Size().
+template<class K, class Value, class Hash = std::hash<K>, size_t MAX_SIZE = SIZE_MAX>
+class GenerationCache {
+public:
+    typedef K Key;
+    enum { MAX_AGE = 2 };
+
+    struct Entry {
+        Value       value;
+        unsigned    lastUsed;
+    };
+    std::unordered_map<Key, Entry, Hash> entries;
+    unsigned    generation = 0;
+    unsigned    hits       = 0;
+    unsigned    misses     = 0;
+
+    // Safe to call from many threads at once, as long as nothing calls Add()
+    // or MarkUsed() meanwhile.
+    const Value *Find(const Key &key) const {
+        auto it = entries.find(key);
+        return (it == entries.end()) ? NULL : &(it->second.value);
+    }
+    // We found this one, and used it again.
+    void MarkUsed(const Key &key) {
+        auto it = entries.find(key);
+        if(it != entries.end()) {
+            it->second.lastUsed = generation;
+        }
+        hits++;
+    }
+    // We didn't, so here's an empty value to fill in.
+    Value *Add(const Key &key) {
+        Entry *e = &entries[key];
+        e->value.Clear();
+        e->lastUsed = generation;
+        misses++;
+        return &(e->value);
+    }
+
+    void EndGeneration() {
+        generation++;
+        size_t size = 0;
+        for(auto it = entries.begin(); it != entries.end();) {
+            if(generation - it->second.lastUsed > MAX_AGE) {
+                it->second.value.Clear();
+                it = entries.erase(it);
+            } else {
+                size += it->second.value.Size();
+                ++it;
+            }
+        }
+        if(size <= MAX_SIZE) return;
+
+        // Still too big, so forget the least recently used first; ties broken
+        // by the hash of the key, so that what we keep doesn't depend on the
+        // order of the map.
+        typedef typename std::unordered_map<Key, Entry, Hash>::iterator Iterator;
+        std::vector<Iterator> byAge;
+        for(auto it = entries.begin(); it != entries.end(); ++it) {
+            byAge.push_back(it);
+        }
+        std::sort(byAge.begin(), byAge.end(), [](const Iterator &a, const Iterator &b) {
+            if(a->second.lastUsed != b->second.lastUsed) {
+                return a->second.lastUsed < b->second.lastUsed;
+            }
+            return Hash()(a->first) < Hash()(b->first);
+        });
+        for(Iterator it : byAge) {
+            if(size <= MAX_SIZE) break;
+            size -= it->second.value.Size();
+            it->second.value.Clear();
+            entries.erase(it);
+        }
+    }
+
+    double HitRate() const {
+        unsigned total = hits + misses;
+        return (total == 0) ? 0.0 : (double)hits / total;
+    }
+    void Clear() {
+        for(auto &it : entries) {
+            it.second.value.Clear();
+        }
+        entries.clear();
+        hits = misses = 0;
+    }
+};
+
 class Vector4 {
 public:
     double w, x, y, z;
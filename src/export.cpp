@@ -400,49 +400,52 @@ void SolveSpaceUI::ExportLinesAndMesh(SEdgeList *sel, SBezierList *sbl, SMesh *s
     // And now we perform hidden line removal if requested
     SEdgeList hlrd = {};
     if(sm) {
-        SKdNode *root = SKdNode::From(&smp);
+        SMeshBvh bvh = {};
+        bvh.MakeFromCopyOf(&smp);
 
         // Generate the edges where a curved surface turns from front-facing
         // to back-facing.
         if(SS.GW.showEdges || SS.GW.showOutlines) {
-            root->MakeCertainEdgesInto(sel, EdgeKind::TURNING,
-                                       /*coplanarIsInter=*/false, NULL, NULL,
-                                       GW.showOutlines ? Style::OUTLINE : Style::SOLID_EDGE);
+            bvh.MakeCertainEdgesInto(sel, EdgeKind::TURNING,
+                                     /*coplanarIsInter=*/false, NULL, NULL,
+                                     GW.showOutlines ? Style::OUTLINE : Style::SOLID_EDGE);
         }
 
-        root->ClearTags();
-        int cnt = 1234;
-
-        SEdge *se;
-        for(se = sel->l.First(); se; se = sel->l.NextAfter(se)) {
+        // Each edge is split against the mesh independently, so do them in
+        // parallel; then gather the pieces in the original order, so that
+        // the output doesn't depend on the threads.
+        std::vector<SEdgeList> split(sel->l.n);
+#pragma omp parallel for schedule(dynamic)
+        for(int i = 0; i < sel->l.n; i++) {
+            const SEdge *se = &sel->l[i];
+            SEdgeList *edges = &split[i];
+            edges->AddEdge(se->a, se->b, se->auxA);
             if(se->auxA == Style::CONSTRAINT) {
                 // Constraints should not get hidden line removed; they're
                 // always on top.
-                hlrd.AddEdge(se->a, se->b, se->auxA);
                 continue;
             }
 
-            SEdgeList edges = {};
             // Split the original edge against the mesh
-            edges.AddEdge(se->a, se->b, se->auxA);
-            root->OcclusionTestLine(*se, &edges, cnt);
+            bvh.OcclusionTestLine(*se, edges);
             if(SS.GW.drawOccludedAs == GraphicsWindow::DrawOccludedAs::STIPPLED) {
-                for(SEdge &se : edges.l) {
-                    if(se.tag == 1) {
-                        se.auxA = Style::HIDDEN_EDGE;
+                for(SEdge &sen : edges->l) {
+                    if(sen.tag == 1) {
+                        sen.auxA = Style::HIDDEN_EDGE;
                     }
                 }
             } else if(SS.GW.drawOccludedAs == GraphicsWindow::DrawOccludedAs::INVISIBLE) {
-                edges.l.RemoveTagged();
+                edges->l.RemoveTagged();
             }
 
             // the occlusion test splits unnecessarily; so fix those
-            edges.MergeCollinearSegments(se->a, se->b);
-            cnt++;
-            // And add the results to our output
-            SEdge *sen;
-            for(sen = edges.l.First(); sen; sen = edges.l.NextAfter(sen)) {
-                hlrd.AddEdge(sen->a, sen->b, sen->auxA);
+            edges->MergeCollinearSegments(se->a, se->b);
+        }
+
+        // And add the results to our output
+        for(SEdgeList &edges : split) {
+            for(const SEdge &sen : edges.l) {
+                hlrd.AddEdge(sen.a, sen.b, sen.auxA);
             }
             edges.Clear();
         }
@@ -897,9 +900,12 @@ void SolveSpaceUI::ExportMeshAsStlTo(FILE *f, SMesh *sm) {
 // identical vertices to the same identifier, so do that first.
 //-----------------------------------------------------------------------------
 void SolveSpaceUI::ExportMeshAsObjTo(FILE *fObj, FILE *fMtl, SMesh *sm) {
+    SCompactMesh cm = {};
+    cm.MakeFromCopyOf(sm);
+
     std::map<RgbaColor, std::string, RgbaColorCompare> colors;
-    for(const STriangle &t : sm->l) {
-        RgbaColor color = t.meta.color;
+    for(const STriMeta &meta : cm.metas) {
+        RgbaColor color = meta.color;
         if(colors.find(color) == colors.end()) {
             std::string id = ssprintf("h%02x%02x%02x",
                                       color.red,
@@ -907,10 +913,10 @@ void SolveSpaceUI::ExportMeshAsObjTo(FILE *fObj, FILE *fMtl, SMesh *sm) {
                                       color.blue);
             colors.emplace(color, id);
         }
-        for(int i = 0; i < 3; i++) {
-            fprintf(fObj, "v %.10f %.10f %.10f\n",
-                    CO(t.vertices[i].ScaledBy(1 / SS.exportScale)));
-        }
+    }
+    for(uint32_t i = 0; i < cm.VertexCount(); i++) {
+        fprintf(fObj, "v %.10f %.10f %.10f\n",
+                CO(cm.Vertex(i).ScaledBy(1 / SS.exportScale)));
     }
 
     for(auto &it : colors) {
@@ -920,27 +926,26 @@ void SolveSpaceUI::ExportMeshAsObjTo(FILE *fObj, FILE *fMtl, SMesh *sm) {
                 it.first.redF(), it.first.greenF(), it.first.blueF());
     }
 
-    for(const STriangle &t : sm->l) {
-        for(int i = 0; i < 3; i++) {
-            Vector n = t.normals[i].WithMagnitude(1.0);
-            fprintf(fObj, "vn %.10f %.10f %.10f\n",
-                    CO(n));
-        }
+    for(uint32_t i = 0; i < cm.normals.size() / 3; i++) {
+        Vector n = cm.Normal(i).WithMagnitude(1.0);
+        fprintf(fObj, "vn %.10f %.10f %.10f\n",
+                CO(n));
     }
 
     RgbaColor currentColor = {};
-    for(int i = 0; i < sm->l.n; i++) {
-        const STriangle &t = sm->l[i];
-        if(!currentColor.Equals(t.meta.color)) {
-            currentColor = t.meta.color;
+    for(const SCompactMesh::Triangle &t : cm.triangles) {
+        RgbaColor color = cm.metas[t.meta].color;
+        if(!currentColor.Equals(color)) {
+            currentColor = color;
             fprintf(fObj, "usemtl %s\n", colors[currentColor].c_str());
         }
 
-        fprintf(fObj, "f %d//%d %d//%d %d//%d\n",
-                i * 3 + 1, i * 3 + 1,
-                i * 3 + 2, i * 3 + 2,
-                i * 3 + 3, i * 3 + 3);
+        fprintf(fObj, "f %u//%u %u//%u %u//%u\n",
+                t.vertices[0] + 1, t.normals[0] + 1,
+                t.vertices[1] + 1, t.normals[1] + 1,
+                t.vertices[2] + 1, t.normals[2] + 1);
     }
+    cm.Clear();
 }
 
 //-----------------------------------------------------------------------------
@@ -949,8 +954,8 @@ void SolveSpaceUI::ExportMeshAsObjTo(FILE *fObj, FILE *fMtl, SMesh *sm) {
 void SolveSpaceUI::ExportMeshAsThreeJsTo(FILE *f, const Platform::Path &filename,
                                          SMesh *sm, SOutlineList *sol)
 {
-    SPointList spl = {};
-    STriangle *tr;
+    SCompactMesh cm = {};
+    cm.MakeFromCopyOf(sm);
     Vector bndl, bndh;
 
     const std::string THREE_FN("three-r111.min.js");
@@ -1002,7 +1007,7 @@ void SolveSpaceUI::ExportMeshAsThreeJsTo(FILE *f, const Platform::Path &filename
     // the default viewer, but the defaults are fine for a model which
     // only rotates about the world origin.
 
-    sm->GetBounding(&bndh, &bndl);
+    cm.GetBounding(&bndh, &bndl);
     double largerBoundXY = max((bndh.x - bndl.x), (bndh.y - bndl.y));
     double largerBoundZ = max(largerBoundXY, (bndh.z - bndl.z + 1));
 
@@ -1053,47 +1058,42 @@ void SolveSpaceUI::ExportMeshAsThreeJsTo(FILE *f, const Platform::Path &filename
     fprintf(f, "    ],\n"
                "    a: %f\n", SS.ambientIntensity);
 
-    for(tr = sm->l.First(); tr; tr = sm->l.NextAfter(tr)) {
-        spl.IncrementTagFor(tr->a);
-        spl.IncrementTagFor(tr->b);
-        spl.IncrementTagFor(tr->c);
-    }
-
     // Output all the vertices.
-    SPoint *sp;
     fputs("  },\n"
           "  points: [\n", f);
-    for(sp = spl.l.First(); sp; sp = spl.l.NextAfter(sp)) {
+    for(uint32_t i = 0; i < cm.VertexCount(); i++) {
+        Vector p = cm.Vertex(i);
         fprintf(f, "    [%f, %f, %f],\n",
-                sp->p.x / SS.exportScale,
-                sp->p.y / SS.exportScale,
-                sp->p.z / SS.exportScale);
+                p.x / SS.exportScale,
+                p.y / SS.exportScale,
+                p.z / SS.exportScale);
     }
 
     fputs("  ],\n"
           "  faces: [\n", f);
     // And now all the triangular faces, in terms of those vertices.
     // This time we count from zero.
-    for(tr = sm->l.First(); tr; tr = sm->l.NextAfter(tr)) {
-        fprintf(f, "    [%d, %d, %d],\n",
-                spl.IndexForPoint(tr->a),
-                spl.IndexForPoint(tr->b),
-                spl.IndexForPoint(tr->c));
+    for(const SCompactMesh::Triangle &t : cm.triangles) {
+        fprintf(f, "    [%u, %u, %u],\n",
+                t.vertices[0], t.vertices[1], t.vertices[2]);
     }
 
     // Output face normals.
     fputs("  ],\n"
           "  normals: [\n", f);
-    for(tr = sm->l.First(); tr; tr = sm->l.NextAfter(tr)) {
+    for(const SCompactMesh::Triangle &t : cm.triangles) {
+        Vector an = cm.Normal(t.normals[0]),
+               bn = cm.Normal(t.normals[1]),
+               cn = cm.Normal(t.normals[2]);
         fprintf(f, "    [[%f, %f, %f], [%f, %f, %f], [%f, %f, %f]],\n",
-                CO(tr->an), CO(tr->bn), CO(tr->cn));
+                CO(an), CO(bn), CO(cn));
     }
 
     fputs("  ],\n"
           "  colors: [\n", f);
     // Output triangle colors.
-    for(tr = sm->l.First(); tr; tr = sm->l.NextAfter(tr)) {
-        fprintf(f, "    0x%x,\n", tr->meta.color.ToARGB32());
+    for(const SCompactMesh::Triangle &t : cm.triangles) {
+        fprintf(f, "    0x%x,\n", cm.metas[t.meta].color.ToARGB32());
     }
 
     fputs("  ],\n"
@@ -1121,7 +1121,7 @@ void SolveSpaceUI::ExportMeshAsThreeJsTo(FILE *f, const Platform::Path &filename
                 CO(SS.GW.projRight));
     }
 
-    spl.Clear();
+    cm.Clear();
 }
 
 //-----------------------------------------------------------------------------
@@ -1129,12 +1129,11 @@ void SolveSpaceUI::ExportMeshAsThreeJsTo(FILE *f, const Platform::Path &filename
 //-----------------------------------------------------------------------------
 void SolveSpaceUI::ExportMeshAsVrmlTo(FILE *f, const Platform::Path &filename, SMesh *sm) {
     struct STriangleSpan {
-        STriangle *first, *past_last;
-
-        STriangle *begin() const { return first; }
-        STriangle *end() const { return past_last; }
+        size_t first, past_last;
     };
 
+    SCompactMesh cm = {};
+    cm.MakeFromCopyOf(sm);
 
     std::string basename = filename.FileStem();
     for(auto & c : basename) {
@@ -1152,17 +1151,19 @@ void SolveSpaceUI::ExportMeshAsVrmlTo(FILE *f, const Platform::Path &filename, S
             basename.c_str());
 
 
+    auto colorOf = [&](size_t i) { return cm.metas[cm.triangles[i].meta].color; };
+
     std::map<std::uint8_t, std::vector<STriangleSpan>> opacities;
-    STriangle *start          = sm->l.begin();
-    std::uint8_t last_opacity = start->meta.color.alpha;
-    for(auto & tr : sm->l) {
-        if(tr.meta.color.alpha != last_opacity) {
-            opacities[last_opacity].push_back(STriangleSpan{start, &tr});
-            start = &tr;
-            last_opacity = start->meta.color.alpha;
+    size_t start              = 0;
+    std::uint8_t last_opacity = colorOf(start).alpha;
+    for(size_t i = 0; i < cm.triangles.size(); i++) {
+        if(colorOf(i).alpha != last_opacity) {
+            opacities[last_opacity].push_back(STriangleSpan{start, i});
+            start = i;
+            last_opacity = colorOf(start).alpha;
         }
     }
-    opacities[last_opacity].push_back(STriangleSpan{start, sm->l.end()});
+    opacities[last_opacity].push_back(STriangleSpan{start, cm.triangles.size()});
 
     for(auto && op : opacities) {
         fprintf(f, "\n"
@@ -1185,33 +1186,38 @@ void SolveSpaceUI::ExportMeshAsVrmlTo(FILE *f, const Platform::Path &filename, S
                 SS.ambientIntensity,
                 1.f - ((float)op.first / 255.0f));
 
-        SPointList spl = {};
-
+        // Number the vertices that this shape uses, in order of first use.
+        std::vector<int> index(cm.VertexCount(), -1);
+        std::vector<uint32_t> used;
         for(const auto & sp : op.second) {
-            for(const auto & tr : sp) {
-                spl.IncrementTagFor(tr.a);
-                spl.IncrementTagFor(tr.b);
-                spl.IncrementTagFor(tr.c);
+            for(size_t i = sp.first; i < sp.past_last; i++) {
+                for(uint32_t v : cm.triangles[i].vertices) {
+                    if(index[v] >= 0) continue;
+                    index[v] = (int)used.size();
+                    used.push_back(v);
+                }
             }
         }
 
         // Output all the vertices.
-        for(auto sp : spl.l) {
+        for(uint32_t v : used) {
+            Vector p = cm.Vertex(v);
             fprintf(f, "          %f %f %f,\n",
-                    sp.p.x / SS.exportScale,
-                    sp.p.y / SS.exportScale,
-                    sp.p.z / SS.exportScale);
+                    p.x / SS.exportScale,
+                    p.y / SS.exportScale,
+                    p.z / SS.exportScale);
         }
 
         fputs("        ] }\n"
               "        coordIndex [\n", f);
         // And now all the triangular faces, in terms of those vertices.
         for(const auto & sp : op.second) {
-            for(const auto & tr : sp) {
+            for(size_t i = sp.first; i < sp.past_last; i++) {
+                const SCompactMesh::Triangle &t = cm.triangles[i];
                 fprintf(f, "          %d, %d, %d, -1,\n",
-                        spl.IndexForPoint(tr.a),
-                        spl.IndexForPoint(tr.b),
-                        spl.IndexForPoint(tr.c));
+                        index[t.vertices[0]],
+                        index[t.vertices[1]],
+                        index[t.vertices[2]]);
             }
         }
 
@@ -1221,18 +1227,19 @@ void SolveSpaceUI::ExportMeshAsVrmlTo(FILE *f, const Platform::Path &filename, S
         std::vector<int> triangle_colour_ids;
         std::vector<RgbaColor> colours_present;
         for(const auto & sp : op.second) {
-            for(const auto & tr : sp) {
+            for(size_t i = sp.first; i < sp.past_last; i++) {
+                RgbaColor color = colorOf(i);
                 const auto colour_itr = std::find_if(colours_present.begin(), colours_present.end(),
                                                      [&](const RgbaColor & c) {
-                                                         return c.Equals(tr.meta.color);
+                                                         return c.Equals(color);
                                                      });
                 if(colour_itr == colours_present.end()) {
                     fprintf(f, "          %.10f %.10f %.10f,\n",
-                            tr.meta.color.redF(),
-                            tr.meta.color.greenF(),
-                            tr.meta.color.blueF());
+                            color.redF(),
+                            color.greenF(),
+                            color.blueF());
                     triangle_colour_ids.push_back(colours_present.size());
-                    colours_present.insert(colours_present.end(), tr.meta.color);
+                    colours_present.insert(colours_present.end(), color);
                 } else {
                     triangle_colour_ids.push_back(colour_itr - colours_present.begin());
                 }
@@ -1249,12 +1256,11 @@ void SolveSpaceUI::ExportMeshAsVrmlTo(FILE *f, const Platform::Path &filename, S
         fputs("        ]\n"
               "      }\n"
               "    }\n", f);
-
-        spl.Clear();
     }
 
     fputs("  ]\n"
           "}\n", f);
+    cm.Clear();
 }
 
 //-----------------------------------------------------------------------------
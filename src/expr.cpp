@@ -312,17 +312,13 @@ Expr *Expr::DeepCopyWithParamsAsPointers(IdList<Param,hParam> *firstTry,
     Expr *n = AllocExpr();
     if(op == Op::PARAM) {
         // A param that is referenced by its hParam gets rewritten to go
-        // straight in to the parameter table with a pointer, or simply
-        // into a constant if it's already known.
+        // straight in to the parameter table with a pointer. That's so even
+        // if it's already known, so that the copy still holds when it's
+        // given a new value, like while dragging.
         Param *p = firstTry->FindByIdNoOops(parh);
         if(!p) p = thenTry->FindById(parh);
-        if(p->known) {
-            n->op = Op::CONSTANT;
-            n->v = p->val;
-        } else {
-            n->op = Op::PARAM_PTR;
-            n->parp = p;
-        }
+        n->op = Op::PARAM_PTR;
+        n->parp = p;
         return n;
     }
 
@@ -933,3 +929,197 @@ Expr *Expr::From(const std::string &input, bool popUpError) {
     }
     return e;
 }
+
+//-----------------------------------------------------------------------------
+// Compile expressions to a flat list of register instructions, for the
+// solver's inner loop.
+//-----------------------------------------------------------------------------
+size_t ExprTape::KeyHash::operator()(const Key &k) const {
+    size_t h = std::hash<uint64_t>()(k.a);
+    h ^= std::hash<uint64_t>()(k.b) + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+    h ^= (size_t)k.op + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+    return h;
+}
+
+void ExprTape::Clear() {
+    code.clear();
+    reg.clear();
+    known.clear();
+    instrOf.clear();
+}
+
+int ExprTape::Register(const Key &k, const Instr &i) {
+    auto it = known.find(k);
+    if(it != known.end()) return it->second;
+
+    int r = (int)reg.size();
+    reg.push_back(0.0);
+    known[k] = r;
+    if(i.op != Expr::Op::CONSTANT) {
+        Instr ni = i;
+        ni.dest = r;
+        instrOf.push_back((int)code.size());
+        code.push_back(ni);
+    } else {
+        instrOf.push_back(-1);
+    }
+    return r;
+}
+
+int ExprTape::Compile(const Expr *e) {
+    Instr i = {};
+    i.op = e->op;
+    Key k = {};
+    k.op = e->op;
+
+    switch(e->op) {
+        case Expr::Op::PARAM_PTR:
+            i.parp = e->parp;
+            i.src  = &e->parp->val;
+            k.a = (uint64_t)(uintptr_t)e->parp;
+            return Register(k, i);
+
+        case Expr::Op::CONSTANT: {
+            memcpy(&k.a, &e->v, sizeof(double));
+            int r = Register(k, i);
+            reg[r] = e->v;
+            return r;
+        }
+
+        case Expr::Op::PARAM:
+        case Expr::Op::VARIABLE:
+            ssassert(false, "Expected an expression that refers to params via pointers");
+
+        case Expr::Op::PLUS:
+        case Expr::Op::TIMES:
+            i.a = Compile(e->a);
+            i.b = Compile(e->b);
+            // These commute exactly, so a*b and b*a can share a register.
+            if(i.a > i.b) swap(i.a, i.b);
+            k.a = i.a;
+            k.b = i.b;
+            return Register(k, i);
+
+        case Expr::Op::MINUS:
+        case Expr::Op::DIV:
+            i.a = Compile(e->a);
+            i.b = Compile(e->b);
+            k.a = i.a;
+            k.b = i.b;
+            return Register(k, i);
+
+        case Expr::Op::NEGATE:
+        case Expr::Op::SQRT:
+        case Expr::Op::SQUARE:
+        case Expr::Op::SIN:
+        case Expr::Op::COS:
+        case Expr::Op::ASIN:
+        case Expr::Op::ACOS:
+            i.a = Compile(e->a);
+            k.a = i.a;
+            return Register(k, i);
+    }
+    ssassert(false, "Unexpected operation");
+}
+
+void ExprTape::Eval() {
+    double *r = reg.data();
+    for(const Instr &i : code) {
+        double v;
+        switch(i.op) {
+            case Expr::Op::PARAM_PTR:   v = *i.src; break;
+
+            case Expr::Op::PLUS:        v = r[i.a] + r[i.b]; break;
+            case Expr::Op::MINUS:       v = r[i.a] - r[i.b]; break;
+            case Expr::Op::TIMES:       v = r[i.a] * r[i.b]; break;
+            case Expr::Op::DIV:         v = r[i.a] / r[i.b]; break;
+
+            case Expr::Op::NEGATE:      v = -r[i.a]; break;
+            case Expr::Op::SQRT:        v = sqrt(r[i.a]); break;
+            case Expr::Op::SQUARE:      v = r[i.a] * r[i.a]; break;
+            case Expr::Op::SIN:         v = sin(r[i.a]); break;
+            case Expr::Op::COS:         v = cos(r[i.a]); break;
+            case Expr::Op::ASIN:        v = asin(r[i.a]); break;
+            case Expr::Op::ACOS:        v = acos(r[i.a]); break;
+
+            default: ssassert(false, "Unexpected operation");
+        }
+        r[i.dest] = v;
+    }
+}
+
+void ExprTape::Dependencies(int r, std::vector<int> *deps) const {
+    deps->clear();
+    std::vector<int> stack;
+    std::unordered_set<int> seen;
+    stack.push_back(r);
+    while(!stack.empty()) {
+        int k = instrOf[stack.back()];
+        stack.pop_back();
+        if(k < 0 || !seen.insert(k).second) continue;
+        deps->push_back(k);
+
+        const Instr &i = code[k];
+        switch(i.op) {
+            case Expr::Op::PARAM_PTR:
+                break;
+
+            case Expr::Op::PLUS:
+            case Expr::Op::MINUS:
+            case Expr::Op::TIMES:
+            case Expr::Op::DIV:
+                stack.push_back(i.b);
+                stack.push_back(i.a);
+                break;
+
+            default:
+                stack.push_back(i.a);
+                break;
+        }
+    }
+    // Instructions come after everything they read, so this is an
+    // evaluation order.
+    std::sort(deps->begin(), deps->end());
+}
+
+void ExprTape::Backprop(int r, const std::vector<int> &deps, double *adj) const {
+    const double *v = reg.data();
+    adj[r] = 1.0;
+    for(auto it = deps.rbegin(); it != deps.rend(); ++it) {
+        const Instr &i = code[*it];
+        double g = adj[i.dest];
+        if(EXACT(g == 0.0)) continue;
+
+        switch(i.op) {
+            case Expr::Op::PARAM_PTR:
+                break;
+
+            case Expr::Op::PLUS:
+                adj[i.a] += g;
+                adj[i.b] += g;
+                break;
+            case Expr::Op::MINUS:
+                adj[i.a] += g;
+                adj[i.b] -= g;
+                break;
+            case Expr::Op::TIMES:
+                adj[i.a] += g * v[i.b];
+                adj[i.b] += g * v[i.a];
+                break;
+            case Expr::Op::DIV:
+                adj[i.a] += g / v[i.b];
+                adj[i.b] -= g * v[i.a] / (v[i.b] * v[i.b]);
+                break;
+
+            case Expr::Op::NEGATE:  adj[i.a] -= g; break;
+            case Expr::Op::SQRT:    adj[i.a] += g * 0.5 / v[i.dest]; break;
+            case Expr::Op::SQUARE:  adj[i.a] += g * 2.0 * v[i.a]; break;
+            case Expr::Op::SIN:     adj[i.a] += g * cos(v[i.a]); break;
+            case Expr::Op::COS:     adj[i.a] -= g * sin(v[i.a]); break;
+            case Expr::Op::ASIN:    adj[i.a] += g / sqrt(1 - v[i.a] * v[i.a]); break;
+            case Expr::Op::ACOS:    adj[i.a] -= g / sqrt(1 - v[i.a] * v[i.a]); break;
+
+            default: ssassert(false, "Unexpected operation");
+        }
+    }
+}
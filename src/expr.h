@@ -138,4 +138,59 @@ public:
 
     Expr *Magnitude() const;
 };
+
+// A set of expressions flattened into a straight-line list of instructions,
+// each of which writes one register. Identical subexpressions (within one
+// expression or across several) are compiled only once, and constants are
+// loaded once at compile time, so evaluating everything is one linear pass
+// over the code instead of a walk over each tree.
+class ExprTape {
+public:
+    struct Instr {
+        Expr::Op    op;
+        int         dest;
+        int         a, b;
+        Param      *parp;
+        // Where a load reads the value from; that's parp->val, unless the
+        // load gets pointed elsewhere.
+        const double *src;
+    };
+
+    std::vector<Instr>      code;
+    std::vector<double>     reg;
+
+    void Clear();
+    // Returns the register that holds the value of e after each Eval(). The
+    // expression must refer to its parameters by pointer.
+    int Compile(const Expr *e);
+    void Eval();
+
+    double Value(int r) const { return reg[r]; }
+
+    // Reverse-mode differentiation. Dependencies() lists the instructions
+    // that register r is computed from, in order; after an Eval(),
+    // Backprop() adds the partial derivative of r with respect to each of
+    // their registers into adj, which must be zero at those registers.
+    void Dependencies(int r, std::vector<int> *deps) const;
+    void Backprop(int r, const std::vector<int> &deps, double *adj) const;
+
+private:
+    struct Key {
+        Expr::Op    op;
+        uint64_t    a, b;
+
+        bool operator==(const Key &k) const {
+            return op == k.op && a == k.a && b == k.b;
+        }
+    };
+    struct KeyHash {
+        size_t operator()(const Key &k) const;
+    };
+
+    std::unordered_map<Key, int, KeyHash> known;
+    // The instruction that writes each register, or -1 for a constant
+    std::vector<int> instrOf;
+
+    int Register(const Key &k, const Instr &i);
+};
 #endif
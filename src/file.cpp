@@ -34,6 +34,11 @@ void SolveSpaceUI::ClearExisting() {
     SK.entity.Clear();
     SK.param.Clear();
     images.clear();
+
+    shellBooleans.Clear();
+    meshBooleans.Clear();
+    intersections.Clear();
+    triangulations.Clear();
 }
 
 hGroup SolveSpaceUI::CreateDefaultDrawingGroup() {
@@ -100,6 +105,7 @@ const SolveSpaceUI::SaveTable SolveSpaceUI::SAVED[] = {
     { 'g',  "Group.skipFirst",          'b',    &(SS.sv.g.skipFirst)          },
     { 'g',  "Group.meshCombine",        'd',    &(SS.sv.g.meshCombine)        },
     { 'g',  "Group.forceToMesh",        'd',    &(SS.sv.g.forceToMesh)        },
+    { 'g',  "Group.meshBoolean",        'd',    &(SS.sv.g.meshBoolean)        },
     { 'g',  "Group.predef.q.w",         'f',    &(SS.sv.g.predef.q.w)         },
     { 'g',  "Group.predef.q.vx",        'f',    &(SS.sv.g.predef.q.vx)        },
     { 'g',  "Group.predef.q.vy",        'f',    &(SS.sv.g.predef.q.vy)        },
@@ -8,6 +8,8 @@
 //-----------------------------------------------------------------------------
 #include "solvespace.h"
 
+#include <thread>
+
 void SolveSpaceUI::MarkGroupDirtyByEntity(hEntity he) {
     Entity *e = SK.GetEntity(he);
     MarkGroupDirty(e->group);
@@ -352,6 +354,13 @@ void SolveSpaceUI::GenerateAll(Generate type, bool andFindFree, bool genForBBox)
         deleted = {};
     }
 
+    // Forget the intersection curves and triangulations that we haven't
+    // needed lately.
+    if(!genForBBox) {
+        intersections.EndGeneration();
+        triangulations.EndGeneration();
+    }
+
     FreeAllTemporary();
     allConsistent = true;
     SS.GW.persistentDirty = true;
@@ -505,6 +514,10 @@ void SolveSpaceUI::WriteEqSystemForGroup(hGroup hg) {
     sys.entity.Clear();
     sys.param.Clear();
     sys.eq.Clear();
+    sys.differentiation = reverseModeJacobian ? System::Differentiation::REVERSE_MODE
+                                              : System::Differentiation::SYMBOLIC;
+    sys.method = dampedSolver ? System::Method::LEVENBERG_MARQUARDT
+                              : System::Method::NEWTON;
     // And generate all the params for requests in this group
     for(auto &req : SK.request) {
         Request *r = &req;
@@ -536,6 +549,7 @@ void SolveSpaceUI::SolveGroup(hGroup hg, bool andFindFree) {
     Group *g = SK.GetGroup(hg);
     g->solved.remove.Clear();
     g->solved.findToFixTimeout = SS.timeoutRedundantConstr;
+    sys.threads = solveInParallel ? (int)std::thread::hardware_concurrency() : 1;
     SolveResult how = sys.Solve(g, NULL,
                                    &(g->solved.dof),
                                    &(g->solved.remove),
@@ -546,6 +560,7 @@ void SolveSpaceUI::SolveGroup(hGroup hg, bool andFindFree) {
         g->dofCheckOk = true;
     }
     g->solved.how = how;
+    g->solved.iterations = sys.stats.iterations;
     FreeAllTemporary();
 }
 
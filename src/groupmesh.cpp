@@ -103,6 +103,13 @@ void SMesh::RemapFaces(Group *g, int remap) {
     }
 }
 
+// Meshes can be combined in more than one way, as chosen for the group; shells
+// only in the one.
+static void UseMeshBoolean(SShell *, Group::MeshBoolean) {}
+static void UseMeshBoolean(SMesh *m, Group::MeshBoolean how) {
+    m->indexedBoolean = (how == Group::MeshBoolean::INDEXED);
+}
+
 template<class T>
 void Group::GenerateForStepAndRepeat(T *steps, T *outs, Group::CombineAs forWhat) {
 
@@ -164,6 +171,7 @@ void Group::GenerateForStepAndRepeat(T *steps, T *outs, Group::CombineAs forWhat
                 (soFar->at(a)).Clear();
                 (soFar->at(a+1)).Clear();
             } else {
+                UseMeshBoolean(&(scratch->at(a/2)), meshBoolean);
                 scratch->at(a/2).MakeFromUnionOf(&(soFar->at(a)), &(soFar->at(a+1)));
                 (soFar->at(a)).Clear();
                 (soFar->at(a+1)).Clear();
@@ -176,6 +184,17 @@ void Group::GenerateForStepAndRepeat(T *steps, T *outs, Group::CombineAs forWhat
     *outs = soFar->at(0);
 }
 
+static BooleanCache<SShell> *BooleanCacheFor(SShell *) { return &SS.shellBooleans; }
+static BooleanCache<SMesh>  *BooleanCacheFor(SMesh *)  { return &SS.meshBooleans; }
+
+static void CopyBooleanResult(SShell *to, SShell *from) {
+    to->MakeFromCopyOf(from);
+    to->booleanFailed = from->booleanFailed;
+}
+static void CopyBooleanResult(SMesh *to, SMesh *from) {
+    to->MakeFromCopyOf(from);
+}
+
 template<class T>
 void Group::GenerateForBoolean(T *prevs, T *thiss, T *outs, Group::CombineAs how) {
     // If this group contributes no new mesh, then our running mesh is the
@@ -186,8 +205,29 @@ void Group::GenerateForBoolean(T *prevs, T *thiss, T *outs, Group::CombineAs how
         return;
     }
 
+    // If we've been regenerated but our operands haven't changed, as after
+    // editing something in a later group, then we might have the result
+    // already. Assemblies are cheap, so don't bother with those.
+    BooleanCache<T> *cache = NULL;
+    typename BooleanCache<T>::Key key = {};
+    if(how != CombineAs::ASSEMBLE) {
+        cache = BooleanCacheFor(outs);
+        key.hashA       = prevs->ContentHash();
+        key.hashB       = thiss->ContentHash();
+        key.how         = how;
+        key.meshBoolean = meshBoolean;
+        key.chordTol    = SS.ChordTolMm();
+        key.maxSegments = SS.GetMaxSegments();
+        T *found = cache->Find(key);
+        if(found != NULL) {
+            CopyBooleanResult(outs, found);
+            return;
+        }
+    }
+
     // So our group's shell appears in thisShell. Combine this with the
     // previous group's shell, using the requested operation.
+    UseMeshBoolean(outs, meshBoolean);
     switch(how) {
         case CombineAs::UNION:
             outs->MakeFromUnionOf(prevs, thiss);
@@ -205,6 +245,10 @@ void Group::GenerateForBoolean(T *prevs, T *thiss, T *outs, Group::CombineAs how
             outs->MakeFromAssemblyOf(prevs, thiss);
             break;
     }
+
+    if(cache != NULL) {
+        CopyBooleanResult(cache->Add(key), outs);
+    }
 }
 
 void Group::GenerateShellAndMesh() {
@@ -435,9 +479,11 @@ void Group::GenerateShellAndMesh() {
 
         if(srcg->meshCombine != CombineAs::ASSEMBLE) {
             // And make sure that the output mesh is vertex-to-vertex.
-            SKdNode *root = SKdNode::From(&outm);
-            root->SnapToMesh(&outm);
-            root->MakeMeshInto(&runningMesh);
+            SMeshBvh bvh = {};
+            bvh.MakeFromCopyOf(&outm);
+            bvh.SnapToMesh(&outm);
+            bvh.MakeMeshInto(&runningMesh);
+            bvh.Clear();
         } else {
             runningMesh.MakeFromCopyOf(&outm);
         }
@@ -450,11 +496,12 @@ void Group::GenerateShellAndMesh() {
     displayDirty = true;
 }
 
-void Group::GenerateDisplayItems() {
+void Group::GenerateDisplayItems(bool preview) {
     // This is potentially slow (since we've got to triangulate a shell, or
     // to find the emphasized edges for a mesh), so we will run it only
-    // if its inputs have changed.
-    if(displayDirty) {
+    // if its inputs have changed, or if we have just a preview and need
+    // better.
+    if(displayDirty || (displayPreview && !preview)) {
         Group *pg = RunningMeshGroup();
         if(pg && thisMesh.IsEmpty() && thisShell.IsEmpty()) {
             // We don't contribute any new solid model in this group, so our
@@ -465,10 +512,11 @@ void Group::GenerateDisplayItems() {
             // Note that this can end up recursing multiple times (if multiple
             // groups that contribute no solid model exist in sequence), but
             // that's okay.
-            pg->GenerateDisplayItems();
+            pg->GenerateDisplayItems(preview);
 
             displayMesh.Clear();
             displayMesh.MakeFromCopyOf(&(pg->displayMesh));
+            displayPreview = pg->displayPreview;
 
             displayOutlines.Clear();
             if(SS.GW.showEdges || SS.GW.showOutlines) {
@@ -478,7 +526,7 @@ void Group::GenerateDisplayItems() {
             // We do contribute new solid model, so we have to triangulate the
             // shell, and edge-find the mesh.
             displayMesh.Clear();
-            runningShell.TriangulateInto(&displayMesh);
+            displayPreview = !runningShell.TriangulateInto(&displayMesh, preview);
             STriangle *t;
             for(t = runningMesh.l.First(); t; t = runningMesh.l.NextAfter(t)) {
                 STriangle trn = *t;
@@ -516,6 +564,9 @@ void Group::GenerateDisplayItems() {
         if(SS.centerOfMass.draw && SS.centerOfMass.dirty && h == SS.GW.activeGroup) {
             SS.UpdateCenterOfMass();
         }
+        if(displayPreview) {
+            SS.ScheduleRefineDisplay();
+        }
         displayDirty = false;
     }
 }
@@ -643,12 +694,14 @@ void Group::DrawMesh(DrawMeshAs how, Canvas *canvas) {
     }
 }
 
-void Group::Draw(Canvas *canvas) {
+void Group::Draw(Canvas *canvas, bool preview) {
     // Everything here gets drawn whether or not the group is hidden; we
     // can control this stuff independently, with show/hide solids, edges,
     // mesh, etc.
 
-    GenerateDisplayItems();
+    // If asked, show something right away, even if it's coarse; it gets
+    // refined later.
+    GenerateDisplayItems(preview);
     DrawMesh(DrawMeshAs::DEFAULT, canvas);
 
     if(SS.GW.showEdges) {
@@ -8,7 +8,15 @@
 #define EXPORT_DLL
 #include <slvs.h>
 
-Sketch SolveSpace::SK = {};
+#if !defined(__EMSCRIPTEN__)
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+
+// Each thread copies the systems that it solves into a sketch of its own.
+thread_local Sketch SolveSpace::SK = {};
 static System SYS;
 
 void SolveSpace::Platform::FatalError(const std::string &message) {
@@ -65,8 +73,24 @@ void Slvs_MakeQuaternion(double ux, double uy, double uz,
     *qz = q.vz;
 }
 
-void Slvs_Solve(Slvs_System *ssys, Slvs_hGroup shg)
+} /* extern "C" */
+
+//-----------------------------------------------------------------------------
+// Copy the system into SK and sys, solve it, and write the results back. This
+// touches no other state, so threads can solve at once, each with a System of
+// its own.
+//-----------------------------------------------------------------------------
+static void SolveSystem(System *sys, Slvs_System *ssys, Slvs_hGroup shg)
 {
+    // An earlier system with a bad type may have been abandoned half copied.
+    sys->param.Clear();
+    sys->entity.Clear();
+    sys->eq.Clear();
+    sys->dragged.Clear();
+    SK.param.Clear();
+    SK.entity.Clear();
+    SK.constraint.Clear();
+
     int i;
     for(i = 0; i < ssys->params; i++) {
         Slvs_Param *sp = &(ssys->param[i]);
@@ -76,7 +100,7 @@ void Slvs_Solve(Slvs_System *ssys, Slvs_hGroup shg)
         p.val = sp->val;
         SK.param.Add(&p);
         if(sp->group == shg) {
-            SYS.param.Add(&p);
+            sys->param.Add(&p);
         }
     }
 
@@ -183,7 +207,7 @@ default: dbp("bad constraint type %d", sc->type); return;
             for(Param &p : params) {
                 p.h = SK.param.AddAndAssignId(&p);
                 c.valP = p.h;
-                SYS.param.Add(&p);
+                sys->param.Add(&p);
             }
             params.Clear();
             c.ModifyToSatisfy();
@@ -195,18 +219,20 @@ default: dbp("bad constraint type %d", sc->type); return;
     for(i = 0; i < (int)arraylen(ssys->dragged); i++) {
         if(ssys->dragged[i]) {
             hParam hp = { ssys->dragged[i] };
-            SYS.dragged.Add(&hp);
+            sys->dragged.Add(&hp);
         }
     }
 
     Group g = {};
     g.h.v = shg;
+    // There's no setting for this here, so take as long as it takes
+    g.solved.findToFixTimeout = INT_MAX;
 
     List<hConstraint> bad = {};
 
     // Now we're finally ready to solve!
     bool andFindBad = ssys->calculateFaileds ? true : false;
-    SolveResult how = SYS.Solve(&g, NULL, &(ssys->dof), &bad, andFindBad, /*andFindFree=*/false);
+    SolveResult how = sys->Solve(&g, NULL, &(ssys->dof), &bad, andFindBad, /*andFindFree=*/false);
 
     switch(how) {
         case SolveResult::OKAY:
@@ -243,10 +269,10 @@ default: dbp("bad constraint type %d", sc->type); return;
     }
 
     bad.Clear();
-    SYS.param.Clear();
-    SYS.entity.Clear();
-    SYS.eq.Clear();
-    SYS.dragged.Clear();
+    sys->param.Clear();
+    sys->entity.Clear();
+    sys->eq.Clear();
+    sys->dragged.Clear();
 
     SK.param.Clear();
     SK.entity.Clear();
@@ -255,4 +281,121 @@ default: dbp("bad constraint type %d", sc->type); return;
     FreeAllTemporary();
 }
 
+// The Systems that a context solves with, one for each of its threads; they
+// keep their lists and compiled Jacobians from one batch to the next. The
+// calling thread solves with the first; the others each have a worker thread,
+// which waits for the batches until the context is destroyed, so that its
+// sketch and temporary arena are kept too.
+struct Slvs_Context {
+    std::vector<System> systems;
+#if !defined(__EMSCRIPTEN__)
+    std::vector<std::thread> workers;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    // The batch being solved; it's numbered, so that the workers can tell
+    // when there's a new one.
+    Slvs_System *ssys  = NULL;
+    int          count = 0;
+    Slvs_hGroup  shg   = 0;
+    uint64_t     batch = 0;
+    std::atomic<int> next;
+    // How many workers haven't finished with the batch yet
+    int          busy  = 0;
+    bool         quit  = false;
+#endif
+};
+
+#if !defined(__EMSCRIPTEN__)
+// Take systems from the batch in turn, until there are none left.
+static void SolveSomeOfBatch(Slvs_Context *ctx, System *sys) {
+    int i;
+    while((i = ctx->next++) < ctx->count) {
+        SolveSystem(sys, &ctx->ssys[i], ctx->shg);
+    }
+}
+
+static void RunWorker(Slvs_Context *ctx, System *sys) {
+    uint64_t seen = 0;
+    for(;;) {
+        {
+            std::unique_lock<std::mutex> lock(ctx->mutex);
+            ctx->wake.wait(lock, [&]() { return ctx->quit || ctx->batch != seen; });
+            if(ctx->quit) return;
+            seen = ctx->batch;
+        }
+        SolveSomeOfBatch(ctx, sys);
+        {
+            std::lock_guard<std::mutex> lock(ctx->mutex);
+            if(--ctx->busy == 0) ctx->done.notify_one();
+        }
+    }
+}
+#endif
+
+extern "C" {
+
+void Slvs_Solve(Slvs_System *ssys, Slvs_hGroup shg)
+{
+    SolveSystem(&SYS, ssys, shg);
+}
+
+Slvs_Context *Slvs_CreateContext(int threads)
+{
+#if !defined(__EMSCRIPTEN__)
+    if(threads <= 0) threads = (int)std::thread::hardware_concurrency();
+#else
+    threads = 1;
+#endif
+    Slvs_Context *ctx = new Slvs_Context;
+    ctx->systems.resize(max(threads, 1));
+#if !defined(__EMSCRIPTEN__)
+    for(size_t w = 1; w < ctx->systems.size(); w++) {
+        ctx->workers.emplace_back(RunWorker, ctx, &ctx->systems[w]);
+    }
+#endif
+    return ctx;
+}
+
+void Slvs_DestroyContext(Slvs_Context *ctx)
+{
+#if !defined(__EMSCRIPTEN__)
+    {
+        std::lock_guard<std::mutex> lock(ctx->mutex);
+        ctx->quit = true;
+    }
+    ctx->wake.notify_all();
+    for(std::thread &t : ctx->workers) {
+        t.join();
+    }
+#endif
+    delete ctx;
+}
+
+void Slvs_SolveBatch(Slvs_Context *ctx, Slvs_System *ssys, int count, Slvs_hGroup shg)
+{
+#if !defined(__EMSCRIPTEN__)
+    {
+        std::lock_guard<std::mutex> lock(ctx->mutex);
+        ctx->ssys  = ssys;
+        ctx->count = count;
+        ctx->shg   = shg;
+        ctx->next  = 0;
+        ctx->busy  = (int)ctx->workers.size();
+        ctx->batch++;
+    }
+    ctx->wake.notify_all();
+    // This thread works too, and then waits for the workers to finish, so
+    // that none of them is still in this batch when the next one starts.
+    SolveSomeOfBatch(ctx, &ctx->systems[0]);
+    std::unique_lock<std::mutex> lock(ctx->mutex);
+    ctx->done.wait(lock, [&]() { return ctx->busy == 0; });
+#else
+    for(int i = 0; i < count; i++) {
+        SolveSystem(&ctx->systems[0], &ssys[i], shg);
+    }
+#endif
+}
+
 } /* extern "C" */
@@ -82,17 +82,21 @@ void SMesh::MakeEdgesInPlaneInto(SEdgeList *sel, Vector n, double d) {
     m.l.RemoveTagged();
 
     // Select the naked edges in our resulting open mesh.
-    SKdNode *root = SKdNode::From(&m);
-    root->SnapToMesh(&m);
-    root->MakeCertainEdgesInto(sel, EdgeKind::NAKED_OR_SELF_INTER,
-                               /*coplanarIsInter=*/false, NULL, NULL);
+    SMeshBvh bvh = {};
+    bvh.MakeFromCopyOf(&m);
+    bvh.SnapToMesh(&m);
+    bvh.MakeCertainEdgesInto(sel, EdgeKind::NAKED_OR_SELF_INTER,
+                             /*coplanarIsInter=*/false, NULL, NULL);
+    bvh.Clear();
 
     m.Clear();
 }
 
 void SMesh::MakeOutlinesInto(SOutlineList *sol, EdgeKind edgeKind) {
-    SKdNode *root = SKdNode::From(this);
-    root->MakeOutlinesInto(sol, edgeKind);
+    SMeshBvh bvh = {};
+    bvh.MakeFromCopyOf(this);
+    bvh.MakeOutlinesInto(sol, edgeKind);
+    bvh.Clear();
 }
 
 //-----------------------------------------------------------------------------
@@ -260,47 +264,330 @@ void SMesh::AddAgainstBsp(SMesh *srcm, SBsp3 *bsp3) {
     }
 }
 
-void SMesh::MakeFromUnionOf(SMesh *a, SMesh *b) {
-    SBsp3 *bspa = SBsp3::FromMesh(a);
-    SBsp3 *bspb = SBsp3::FromMesh(b);
+//-----------------------------------------------------------------------------
+// Add those parts of the triangles of srcm that we're keeping, as classified
+// against the other operand; either by inserting them into a BSP of it, or by
+// splitting them where they intersect its triangles.
+//-----------------------------------------------------------------------------
+void SMesh::AddAgainst(SMesh *srcm, SMesh *other) {
+    if(indexedBoolean) {
+        SMeshBvh bvh = {};
+        bvh.MakeFromCopyOf(other);
+        AddAgainstMesh(srcm, &bvh);
+        bvh.Clear();
+    } else {
+        AddAgainstBsp(srcm, SBsp3::FromMesh(other));
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Split a convex polygon by a plane, if it has vertices strictly on both
+// sides, into the convex polygons on each side; vertices on the plane belong
+// to both. The pieces keep the polygon's winding.
+//-----------------------------------------------------------------------------
+static bool SplitPolygonByPlane(const std::vector<Vector> &poly, Vector n, double d,
+                                std::vector<Vector> *pos, std::vector<Vector> *neg)
+{
+    int pn = (int)poly.size();
+    std::vector<double> dist(pn);
+    bool above = false, below = false;
+    for(int i = 0; i < pn; i++) {
+        dist[i] = n.Dot(poly[i]) - d;
+        if(dist[i] >  LENGTH_EPS) above = true;
+        if(dist[i] < -LENGTH_EPS) below = true;
+    }
+    if(!(above && below)) return false;
+
+    pos->clear();
+    neg->clear();
+    for(int i = 0; i < pn; i++) {
+        int j = WRAP(i + 1, pn);
+        Vector vi = poly[i], vj = poly[j];
+        double di = dist[i], dj = dist[j];
+        if(di > -LENGTH_EPS) pos->push_back(vi);
+        if(di <  LENGTH_EPS) neg->push_back(vi);
+        if((di > LENGTH_EPS && dj < -LENGTH_EPS) ||
+           (di < -LENGTH_EPS && dj > LENGTH_EPS))
+        {
+            Vector m = vi.Plus((vj.Minus(vi)).ScaledBy(di / (di - dj)));
+            pos->push_back(m);
+            neg->push_back(m);
+        }
+    }
+    return true;
+}
+
+// The interval along the line dir that a convex polygon covers where it meets
+// the plane n, d.
+static void IntervalOnLine(const Vector *v, int vn, Vector n, double d, Vector dir,
+                           double *lo, double *hi)
+{
+    *lo = VERY_POSITIVE;
+    *hi = VERY_NEGATIVE;
+    for(int i = 0; i < vn; i++) {
+        int j = WRAP(i + 1, vn);
+        double di = n.Dot(v[i]) - d, dj = n.Dot(v[j]) - d;
+        if(fabs(di) <= LENGTH_EPS) {
+            double t = dir.Dot(v[i]);
+            *lo = min(*lo, t);
+            *hi = max(*hi, t);
+        }
+        if((di > LENGTH_EPS && dj < -LENGTH_EPS) ||
+           (di < -LENGTH_EPS && dj > LENGTH_EPS))
+        {
+            double t = dir.Dot(v[i].Plus((v[j].Minus(v[i])).ScaledBy(di / (di - dj))));
+            *lo = min(*lo, t);
+            *hi = max(*hi, t);
+        }
+    }
+}
+
+// Whether a convex polygon (which lies in the plane pn, pd) passes through the
+// triangle u (which lies in the plane un, ud), and not just touches it; then
+// the polygon must be split by the plane of u.
+static bool PolygonCrosses(const std::vector<Vector> &poly, Vector pn, double pd,
+                           const STriangle &u, Vector un, double ud)
+{
+    bool pAbove = false, pBelow = false, uAbove = false, uBelow = false;
+    for(const Vector &v : poly) {
+        double dist = un.Dot(v) - ud;
+        if(dist >  LENGTH_EPS) pAbove = true;
+        if(dist < -LENGTH_EPS) pBelow = true;
+    }
+    for(int i = 0; i < 3; i++) {
+        double dist = pn.Dot(u.vertices[i]) - pd;
+        if(dist > -LENGTH_EPS) uAbove = true;
+        if(dist <  LENGTH_EPS) uBelow = true;
+    }
+    if(!(pAbove && pBelow && uAbove && uBelow)) return false;
+
+    Vector dir = pn.Cross(un);
+    // Almost parallel planes; splitting can't be wrong, just wasteful.
+    if(dir.Magnitude() < LENGTH_EPS) return true;
+    dir = dir.WithMagnitude(1);
+
+    double plo, phi, ulo, uhi;
+    IntervalOnLine(&poly[0],   (int)poly.size(), un, ud, dir, &plo, &phi);
+    IntervalOnLine(u.vertices, 3,                pn, pd, dir, &ulo, &uhi);
+    return (plo < uhi - LENGTH_EPS && ulo < phi - LENGTH_EPS);
+}
+
+static void GetPolygonBounding(const std::vector<Vector> &poly, Vector *max, Vector *min) {
+    *max = poly[0];
+    *min = poly[0];
+    for(const Vector &v : poly) v.MakeMaxMin(max, min);
+}
+
+//-----------------------------------------------------------------------------
+// Split a triangle into convex pieces that each lie entirely inside, outside,
+// or on the other mesh: by the plane of each triangle of that mesh that it
+// passes through, and by the edges of each one that it's coplanar with.
+//-----------------------------------------------------------------------------
+static void SplitAgainstMesh(const STriangle &tr, const SMeshBvh *other,
+                             std::vector<std::vector<Vector>> *pieces)
+{
+    pieces->clear();
+    pieces->push_back({ tr.a, tr.b, tr.c });
+
+    Vector trn = tr.Normal();
+    if(trn.Magnitude() < LENGTH_EPS*LENGTH_EPS) return;
+    trn = trn.WithMagnitude(1);
+    double trd = trn.Dot(tr.a);
+
+    Vector max = tr.a, min = tr.a;
+    tr.b.MakeMaxMin(&max, &min);
+    tr.c.MakeMaxMin(&max, &min);
+    std::vector<int> near;
+    other->FindTrianglesNear(max, min, &near);
+    if(near.empty()) return;
+
+    // The bounding boxes of the pieces, so that we don't have to test every
+    // piece against every triangle in detail
+    std::vector<Vector> pmax = { max }, pmin = { min };
+    std::vector<Vector> pos, neg;
+    auto split = [&](int i, Vector n, double d) {
+        if(!SplitPolygonByPlane((*pieces)[i], n, d, &pos, &neg)) return;
+        (*pieces)[i] = pos;
+        pieces->push_back(neg);
+        pmax.emplace_back();
+        pmin.emplace_back();
+        GetPolygonBounding(pos, &pmax[i], &pmin[i]);
+        GetPolygonBounding(neg, &pmax.back(), &pmin.back());
+    };
+
+    for(int first : near) {
+        for(int k = first; k >= 0; k = other->more[k]) {
+            const STriangle &u = other->tri[k];
+            Vector un = u.Normal();
+            if(un.Magnitude() < LENGTH_EPS*LENGTH_EPS) continue;
+            un = un.WithMagnitude(1);
+            double ud = un.Dot(u.a);
+
+            Vector umax = u.a, umin = u.a;
+            u.b.MakeMaxMin(&umax, &umin);
+            u.c.MakeMaxMin(&umax, &umin);
+
+            bool coplanar = true;
+            for(int i = 0; i < 3; i++) {
+                if(fabs(un.Dot(tr.vertices[i]) - ud) > LENGTH_EPS) coplanar = false;
+            }
+
+            if(!coplanar) {
+                int pc = (int)pieces->size();
+                for(int i = 0; i < pc; i++) {
+                    if(Vector::BoundingBoxesDisjoint(pmax[i], pmin[i], umax, umin)) continue;
+                    if(!PolygonCrosses((*pieces)[i], trn, trd, u, un, ud)) continue;
+                    split(i, un, ud);
+                }
+                continue;
+            }
+
+            // In the same plane, so split by the planes through u's edges,
+            // but only those pieces that might overlap u.
+            for(int e = 0; e < 3; e++) {
+                Vector ea = u.vertices[e], eb = u.vertices[WRAP(e + 1, 3)];
+                Vector en = un.Cross(eb.Minus(ea));
+                if(en.Magnitude() < LENGTH_EPS) continue;
+                en = en.WithMagnitude(1);
+
+                int pc = (int)pieces->size();
+                for(int i = 0; i < pc; i++) {
+                    if(Vector::BoundingBoxesDisjoint(pmax[i], pmin[i], umax, umin)) continue;
+                    split(i, en, en.Dot(ea));
+                }
+            }
+        }
+    }
+}
+
+void SMesh::AddAgainstMesh(SMesh *srcm, const SMeshBvh *other) {
+    // Split and classify one triangle, into kept[i]. If no ray from one of
+    // its pieces gave a clean count, then we need the BSP, and that's only
+    // built when we've got one.
+    std::vector<SMesh> kept(srcm->l.n);
+    auto classify = [&](int i, const SBsp3 *bsp) -> bool {
+        const STriangle &st = srcm->l[i];
+        SMesh *km = &kept[i];
+        Vector n = st.Normal();
+        std::vector<std::vector<Vector>> pieces;
+        SplitAgainstMesh(st, other, &pieces);
+
+        bool discarded = false;
+        for(const std::vector<Vector> &p : pieces) {
+            Vector pc = Vector::From(0, 0, 0);
+            for(const Vector &v : p) pc = pc.Plus(v);
+            pc = pc.ScaledBy(1.0 / (double)p.size());
+
+            SMeshBvh::Class how = other->ClassifyPoint(pc, n);
+            if(how == SMeshBvh::Class::AMBIGUOUS) {
+                if(!bsp) {
+                    km->Clear();
+                    return false;
+                }
+                how = (bsp->ClassifyPoint(pc) == BspClass::NEG) ?
+                      SMeshBvh::Class::INSIDE : SMeshBvh::Class::OUTSIDE;
+            }
+
+            bool keep = false;
+            switch(how) {
+                case SMeshBvh::Class::INSIDE:     keep =  keepInsideOtherShell; break;
+                case SMeshBvh::Class::OUTSIDE:    keep = !keepInsideOtherShell; break;
+                case SMeshBvh::Class::COINC_SAME: keep = keepCoplanar && !flipNormal; break;
+                case SMeshBvh::Class::COINC_OPP:  keep = keepCoplanar &&  flipNormal; break;
+                case SMeshBvh::Class::AMBIGUOUS:  ssassert(false, "Unexpected class");
+            }
+            if(!keep) {
+                discarded = true;
+                continue;
+            }
+            for(size_t j = 1; j + 1 < p.size(); j++) {
+                STriangle tr = STriangle::From(st.meta, p[0], p[j], p[j + 1]);
+                if(tr.Normal().Magnitude() < LENGTH_EPS*LENGTH_EPS) continue;
+                if(flipNormal) {
+                    km->AddTriangle(tr.meta, tr.c, tr.b, tr.a);
+                } else {
+                    km->AddTriangle(tr.meta, tr.a, tr.b, tr.c);
+                }
+            }
+        }
+
+        if(!discarded) {
+            // We're keeping all of it, so there's no need to split it.
+            km->Clear();
+            if(flipNormal) {
+                km->AddTriangle(st.meta, st.c, st.b, st.a);
+            } else {
+                km->AddTriangle(st.meta, st.a, st.b, st.c);
+            }
+        } else if(km->l.n > 1) {
+            km->Simplify(0);
+        }
+        return true;
+    };
+
+    // Each triangle is split and classified on its own, so do them in
+    // parallel; then add them in order, so that the result doesn't depend
+    // on the threads.
+    std::vector<char> ambiguous(srcm->l.n);
+#pragma omp parallel for schedule(dynamic)
+    for(int i = 0; i < srcm->l.n; i++) {
+        ambiguous[i] = !classify(i, /*bsp=*/NULL);
+    }
+
+    // The BSP comes from the temporary heap, so build it here and not in
+    // the workers.
+    SBsp3 *bsp = NULL;
+    for(int i = 0; i < srcm->l.n; i++) {
+        if(!ambiguous[i]) continue;
+        if(!bsp) {
+            SMesh om = {};
+            other->MakeMeshInto(&om);
+            bsp = SBsp3::FromMesh(&om);
+            om.Clear();
+        }
+        classify(i, bsp);
+    }
+
+    for(SMesh &km : kept) {
+        for(const STriangle &tr : km.l) {
+            AddTriangle(&tr);
+        }
+        km.Clear();
+    }
+}
 
+void SMesh::MakeFromUnionOf(SMesh *a, SMesh *b) {
     flipNormal = false;
     keepInsideOtherShell = false;
 
     keepCoplanar = true;
-    AddAgainstBsp(b, bspa);
+    AddAgainst(b, a);
 
     keepCoplanar = false;
-    AddAgainstBsp(a, bspb);
+    AddAgainst(a, b);
 }
 
 void SMesh::MakeFromDifferenceOf(SMesh *a, SMesh *b) {
-    SBsp3 *bspa = SBsp3::FromMesh(a);
-    SBsp3 *bspb = SBsp3::FromMesh(b);
-
     flipNormal = true;
     keepCoplanar = true;
     keepInsideOtherShell = true;
-    AddAgainstBsp(b, bspa);
+    AddAgainst(b, a);
 
     flipNormal = false;
     keepCoplanar = false;
     keepInsideOtherShell = false;
-    AddAgainstBsp(a, bspb);
+    AddAgainst(a, b);
 }
 
 void SMesh::MakeFromIntersectionOf(SMesh *a, SMesh *b) {
-    SBsp3 *bspa = SBsp3::FromMesh(a);
-    SBsp3 *bspb = SBsp3::FromMesh(b);
-
     keepInsideOtherShell = true;
     flipNormal = false;
 
     keepCoplanar = false;
-    AddAgainstBsp(a, bspb);
+    AddAgainst(a, b);
 
     keepCoplanar = true;
-    AddAgainstBsp(b, bspa);
+    AddAgainst(b, a);
 }
 
 void SMesh::MakeFromCopyOf(SMesh *a) {
@@ -337,6 +624,22 @@ void SMesh::MakeFromTransformationOf(SMesh *a, Vector trans,
 
 bool SMesh::IsEmpty() const { return (l.IsEmpty()); }
 
+// A hash of the triangles, so that two meshes with the same hash are (almost
+// certainly) identical.
+uint64_t SMesh::ContentHash() const {
+    ContentHasher hash;
+    hash.Add((uint32_t)l.n);
+    for(const STriangle &tr : l) {
+        hash.Add(tr.meta.face);
+        hash.Add(tr.meta.color.ToPackedInt());
+        for(int i = 0; i < 3; i++) {
+            hash.Add(tr.vertices[i]);
+            hash.Add(tr.normals[i]);
+        }
+    }
+    return hash.value;
+}
+
 uint32_t SMesh::FirstIntersectionWith(Point2d mp) const {
     Vector rayPoint = SS.GW.UnProjectPoint3(Vector::From(mp.x, mp.y, 0.0));
     Vector rayDir = SS.GW.UnProjectPoint3(Vector::From(mp.x, mp.y, 1.0)).Minus(rayPoint);
@@ -370,223 +673,367 @@ Vector SMesh::GetCenterOfMass() const {
     return center.ScaledBy(1.0 / vol);
 }
 
-STriangleLl *STriangleLl::Alloc()
-    { return (STriangleLl *)AllocTemporary(sizeof(STriangleLl)); }
-SKdNode *SKdNode::Alloc()
-    { return (SKdNode *)AllocTemporary(sizeof(SKdNode)); }
-
-SKdNode *SKdNode::From(SMesh *m) {
-    int i;
-    STriangle *tra = (STriangle *)AllocTemporary((m->l.n) * sizeof(*tra));
-
-    for(i = 0; i < m->l.n; i++) {
-        tra[i] = m->l[i];
-    }
-
-    srand(0);
-    int n = m->l.n;
-    while(n > 1) {
-        int k = rand() % n;
-        n--;
-        swap(tra[k], tra[n]);
-    }
+//-----------------------------------------------------------------------------
+// Build a bounding volume hierarchy over the given boxes, splitting each node
+// where the surface area heuristic says that the two halves will be cheapest
+// to search. The top of the tree gets split a level at a time, with the nodes
+// of each level in parallel; then the subtrees below that get built in
+// parallel too, and everything gets stitched together in depth-first order.
+//-----------------------------------------------------------------------------
+static const int BVH_LEAF_SIZE = 4;     // a few boxes are faster to just test
+static const int BVH_MAX_LEAF  = 16;    // but not too many
+static const int BVH_BINS      = 16;
+static const int BVH_GRAIN     = 1024;  // a subtree this big gets its own thread
+
+static double BoxCost(Vector max, Vector min) {
+    // Half the surface area of the box, so proportional to how often a
+    // random line goes through it.
+    Vector d = max.Minus(min);
+    return d.x*d.y + d.y*d.z + d.z*d.x;
+}
 
-    STriangleLl *tll = NULL;
-    for(i = 0; i < m->l.n; i++) {
-        STriangleLl *tn = STriangleLl::Alloc();
-        tn->tri = &(tra[i]);
-        tn->next = tll;
-        tll = tn;
+void SBvh::GetBounding(int start, int end, Vector *max, Vector *min) const {
+    *max = Vector::From(VERY_NEGATIVE, VERY_NEGATIVE, VERY_NEGATIVE);
+    *min = Vector::From(VERY_POSITIVE, VERY_POSITIVE, VERY_POSITIVE);
+    for(int i = start; i < end; i++) {
+        int k = item[i];
+        boxMax[k].MakeMaxMin(max, min);
+        boxMin[k].MakeMaxMin(max, min);
     }
-
-    return SKdNode::From(tll);
 }
 
-SKdNode *SKdNode::From(STriangleLl *tll) {
-    int which = 0;
-    SKdNode *ret = Alloc();
-
-    int i;
-    int gtc[3] = { 0, 0, 0 }, ltc[3] = { 0, 0, 0 }, allc = 0;
-    double badness[3] = { 0, 0, 0 };
-    double split[3] = { 0, 0, 0 };
-
-    if(!tll) {
-        goto leaf;
+//-----------------------------------------------------------------------------
+// Decide whether to split item[start] ... item[end - 1], whose boxes have the
+// given bounds; if so, reorder them so that the two halves are on either side
+// of mid. Touches nothing outside that range, so ranges that don't overlap
+// can be split in parallel.
+//-----------------------------------------------------------------------------
+bool SBvh::SplitItems(int start, int end, Vector max, Vector min, int *mid) {
+    int n = end - start;
+    if(n <= BVH_LEAF_SIZE) return false;
+
+    // Bin the boxes by their centers (doubled, which doesn't matter).
+    Vector cmax = Vector::From(VERY_NEGATIVE, VERY_NEGATIVE, VERY_NEGATIVE),
+           cmin = Vector::From(VERY_POSITIVE, VERY_POSITIVE, VERY_POSITIVE);
+    for(int i = start; i < end; i++) {
+        int k = item[i];
+        boxMax[k].Plus(boxMin[k]).MakeMaxMin(&cmax, &cmin);
     }
-
-    for(i = 0; i < 3; i++) {
-        int tcnt = 0;
-        STriangleLl *ll;
-        for(ll = tll; ll; ll = ll->next) {
-            split[i] += (ll->tri->a).Element(i);
-            split[i] += (ll->tri->b).Element(i);
-            split[i] += (ll->tri->c).Element(i);
-            tcnt++;
+    auto binOf = [&](int k, int axis) {
+        double c  = boxMax[k].Element(axis) + boxMin[k].Element(axis),
+               lo = cmin.Element(axis), hi = cmax.Element(axis);
+        int b = (int)((c - lo) / (hi - lo) * BVH_BINS);
+        return std::min(std::max(b, 0), BVH_BINS - 1);
+    };
+
+    double bestCost = VERY_POSITIVE;
+    int bestAxis = -1, bestBin = 0;
+    for(int axis = 0; axis < 3; axis++) {
+        if(cmax.Element(axis) - cmin.Element(axis) < LENGTH_EPS) continue;
+
+        int    count[BVH_BINS] = {};
+        Vector bmax[BVH_BINS], bmin[BVH_BINS];
+        for(int b = 0; b < BVH_BINS; b++) {
+            bmax[b] = Vector::From(VERY_NEGATIVE, VERY_NEGATIVE, VERY_NEGATIVE);
+            bmin[b] = Vector::From(VERY_POSITIVE, VERY_POSITIVE, VERY_POSITIVE);
+        }
+        for(int i = start; i < end; i++) {
+            int k = item[i], b = binOf(k, axis);
+            count[b]++;
+            boxMax[k].MakeMaxMin(&bmax[b], &bmin[b]);
+            boxMin[k].MakeMaxMin(&bmax[b], &bmin[b]);
         }
-        split[i] /= (tcnt*3);
-
-        for(ll = tll; ll; ll = ll->next) {
-            STriangle *tr = ll->tri;
-
-            double a = (tr->a).Element(i),
-                   b = (tr->b).Element(i),
-                   c = (tr->c).Element(i);
 
-            if(a < split[i] + KDTREE_EPS ||
-               b < split[i] + KDTREE_EPS ||
-               c < split[i] + KDTREE_EPS)
-            {
-                ltc[i]++;
+        // The cost of everything above each bin boundary, then below it.
+        double aboveCost[BVH_BINS];
+        Vector amax = Vector::From(VERY_NEGATIVE, VERY_NEGATIVE, VERY_NEGATIVE),
+               amin = Vector::From(VERY_POSITIVE, VERY_POSITIVE, VERY_POSITIVE);
+        int above = 0;
+        for(int b = BVH_BINS - 1; b > 0; b--) {
+            above += count[b];
+            if(count[b] > 0) {
+                bmax[b].MakeMaxMin(&amax, &amin);
+                bmin[b].MakeMaxMin(&amax, &amin);
             }
-            if(a > split[i] - KDTREE_EPS ||
-               b > split[i] - KDTREE_EPS ||
-               c > split[i] - KDTREE_EPS)
-            {
-                gtc[i]++;
+            aboveCost[b] = above * BoxCost(amax, amin);
+        }
+        Vector lmax = Vector::From(VERY_NEGATIVE, VERY_NEGATIVE, VERY_NEGATIVE),
+               lmin = Vector::From(VERY_POSITIVE, VERY_POSITIVE, VERY_POSITIVE);
+        int below = 0;
+        for(int b = 1; b < BVH_BINS; b++) {
+            below += count[b - 1];
+            if(count[b - 1] > 0) {
+                bmax[b - 1].MakeMaxMin(&lmax, &lmin);
+                bmin[b - 1].MakeMaxMin(&lmax, &lmin);
+            }
+            if(below == 0 || below == n) continue;
+            double cost = below * BoxCost(lmax, lmin) + aboveCost[b];
+            if(cost < bestCost) {
+                bestCost = cost;
+                bestAxis = axis;
+                bestBin  = b;
             }
-            if(i == 0) allc++;
         }
-        badness[i] = pow((double)ltc[i], 4) + pow((double)gtc[i], 4);
-    }
-    if(badness[0] < badness[1] && badness[0] < badness[2]) {
-        which = 0;
-    } else if(badness[1] < badness[2]) {
-        which = 1;
-    } else {
-        which = 2;
     }
 
-    if(allc < 3 || allc == gtc[which] || allc == ltc[which]) {
-        goto leaf;
+    if(bestAxis < 0) {
+        // All the centers are in the same place, so nothing to choose between
+        // splits; just keep the leaves small.
+        if(n <= BVH_MAX_LEAF) return false;
+        *mid = (start + end) / 2;
+        return true;
     }
+    // Searching both halves costs a visit to this node, plus their boxes.
+    bestCost += BoxCost(max, min);
+    if(bestCost >= n * BoxCost(max, min) && n <= BVH_MAX_LEAF) return false;
+
+    auto it = std::partition(item.begin() + start, item.begin() + end,
+        [&](int k) { return binOf(k, bestAxis) < bestBin; });
+    *mid = (int)(it - item.begin());
+    return true;
+}
 
-    STriangleLl *ll;
-    STriangleLl *lgt, *llt; lgt = llt = NULL;
-    for(ll = tll; ll; ll = ll->next) {
-        STriangle *tr = ll->tri;
-
-        double a = (tr->a).Element(which),
-               b = (tr->b).Element(which),
-               c = (tr->c).Element(which);
+int SBvh::BuildNode(int start, int end, std::vector<Node> *into) {
+    Node n = {};
+    GetBounding(start, end, &n.max, &n.min);
+    n.start = start;
+    n.end   = end;
+    n.right = -1;
+    int self = (int)into->size();
+    into->push_back(n);
+
+    int mid;
+    if(!SplitItems(start, end, n.max, n.min, &mid)) return self;
+    BuildNode(start, mid, into);
+    int right = BuildNode(mid, end, into);
+    (*into)[self].right = right;
+    return self;
+}
 
-        if(a < split[which] + KDTREE_EPS ||
-           b < split[which] + KDTREE_EPS ||
-           c < split[which] + KDTREE_EPS)
-        {
-            STriangleLl *n = STriangleLl::Alloc();
-            *n = *ll;
-            n->next = llt;
-            llt = n;
+void SBvh::Build(const std::vector<Vector> &max, const std::vector<Vector> &min) {
+    Clear();
+    boxMax = max;
+    boxMin = min;
+    for(int i = 0; i < (int)max.size(); i++) {
+        item.push_back(i);
+    }
+    if(item.empty()) return;
+
+    // The top of the tree, where a node is either split here (with children
+    // left and right) or built below as a whole subtree.
+    struct Piece {
+        int     start, end;
+        int     left, right;
+    };
+    std::vector<Piece> top;
+    top.push_back({ 0, (int)item.size(), -1, -1 });
+    std::vector<int> level;
+    level.push_back(0);
+    while(!level.empty()) {
+        std::vector<int> mid(level.size(), -1);
+#pragma omp parallel for
+        for(int i = 0; i < (int)level.size(); i++) {
+            Piece *p = &top[level[i]];
+            if(p->end - p->start <= BVH_GRAIN) continue;
+            Vector pmax, pmin;
+            GetBounding(p->start, p->end, &pmax, &pmin);
+            if(!SplitItems(p->start, p->end, pmax, pmin, &mid[i])) mid[i] = -1;
         }
-        if(a > split[which] - KDTREE_EPS ||
-           b > split[which] - KDTREE_EPS ||
-           c > split[which] - KDTREE_EPS)
-        {
-            STriangleLl *n = STriangleLl::Alloc();
-            *n = *ll;
-            n->next = lgt;
-            lgt = n;
+
+        std::vector<int> next;
+        for(int i = 0; i < (int)level.size(); i++) {
+            if(mid[i] < 0) continue;
+            Piece p = top[level[i]];
+            top[level[i]].left  = (int)top.size();
+            top.push_back({ p.start, mid[i], -1, -1 });
+            top[level[i]].right = (int)top.size();
+            top.push_back({ mid[i], p.end, -1, -1 });
+            next.push_back(top[level[i]].left);
+            next.push_back(top[level[i]].right);
         }
+        level = next;
     }
 
-    ret->which = which;
-    ret->c = split[which];
-    ret->gt = SKdNode::From(lgt);
-    ret->lt = SKdNode::From(llt);
-    return ret;
+    std::vector<std::vector<Node>> subtree(top.size());
+#pragma omp parallel for schedule(dynamic)
+    for(int i = 0; i < (int)top.size(); i++) {
+        if(top[i].left >= 0) continue;
+        BuildNode(top[i].start, top[i].end, &subtree[i]);
+    }
 
-leaf:
-    ret->tris = tll;
-    return ret;
+    std::function<int(int)> stitch = [&](int i) {
+        int self = (int)node.size();
+        if(top[i].left < 0) {
+            for(Node n : subtree[i]) {
+                if(n.right >= 0) n.right += self;
+                node.push_back(n);
+            }
+            return self;
+        }
+        Node n = {};
+        n.start = top[i].start;
+        n.end   = top[i].end;
+        node.push_back(n);
+        int left  = stitch(top[i].left),
+            right = stitch(top[i].right);
+        node[self].right = right;
+        node[self].max = node[left].max;
+        node[self].min = node[left].min;
+        node[right].max.MakeMaxMin(&node[self].max, &node[self].min);
+        node[right].min.MakeMaxMin(&node[self].max, &node[self].min);
+        return self;
+    };
+    stitch(0);
 }
 
-void SKdNode::ClearTags() const {
-    if(gt && lt) {
-        gt->ClearTags();
-        lt->ClearTags();
-    } else {
-        STriangleLl *ll;
-        for(ll = tris; ll; ll = ll->next) {
-            ll->tri->tag = 0;
+void SBvh::FindOverlapping(Vector max, Vector min, std::vector<int> *found) const {
+    found->clear();
+    if(node.empty()) return;
+
+    std::vector<int> stack;
+    stack.push_back(0);
+    while(!stack.empty()) {
+        int i = stack.back();
+        stack.pop_back();
+        const Node &n = node[i];
+        if(Vector::BoundingBoxesDisjoint(n.max, n.min, max, min)) continue;
+        if(n.right < 0) {
+            for(int j = n.start; j < n.end; j++) {
+                int k = item[j];
+                if(Vector::BoundingBoxesDisjoint(boxMax[k], boxMin[k], max, min)) continue;
+                found->push_back(k);
+            }
+        } else {
+            stack.push_back(n.right);
+            stack.push_back(i + 1);
         }
     }
+    std::sort(found->begin(), found->end());
 }
 
-void SKdNode::AddTriangle(STriangle *tr) {
-    if(gt && lt) {
-        double ta = (tr->a).Element(which),
-               tb = (tr->b).Element(which),
-               tc = (tr->c).Element(which);
-        if(ta < c + KDTREE_EPS ||
-           tb < c + KDTREE_EPS ||
-           tc < c + KDTREE_EPS)
-        {
-            lt->AddTriangle(tr);
+// Whether the line passes within a couple of LENGTH_EPS of the box; that's
+// looser than SSurface::LineEntirelyOutsideBbox(), so nothing that test would
+// keep gets missed.
+static bool LineNearBox(Vector bmax, Vector bmin, Vector a, Vector b, bool asSegment) {
+    const double pad = 2*LENGTH_EPS;
+    Vector d = b.Minus(a);
+    double len = d.Magnitude();
+    if(len < LENGTH_EPS) {
+        return !a.OutsideAndNotOn(bmax.Plus(Vector::From(pad, pad, pad)),
+                                  bmin.Minus(Vector::From(pad, pad, pad)));
+    }
+    d = d.ScaledBy(1.0/len);
+
+    double tmin = asSegment ? -pad       : VERY_NEGATIVE,
+           tmax = asSegment ? len + pad  : VERY_POSITIVE;
+    for(int i = 0; i < 3; i++) {
+        double lo = bmin.Element(i) - pad, hi = bmax.Element(i) + pad,
+               p  = a.Element(i), di = d.Element(i);
+        if(EXACT(di == 0)) {
+            if(p < lo || p > hi) return false;
+            continue;
         }
-        if(ta > c - KDTREE_EPS ||
-           tb > c - KDTREE_EPS ||
-           tc > c - KDTREE_EPS)
-        {
-            gt->AddTriangle(tr);
+        double t0 = (lo - p) / di, t1 = (hi - p) / di;
+        if(t0 > t1) swap(t0, t1);
+        tmin = max(tmin, t0);
+        tmax = min(tmax, t1);
+        if(tmin > tmax) return false;
+    }
+    return true;
+}
+
+void SBvh::FindNearLine(Vector a, Vector b, bool asSegment,
+                        std::vector<int> *found) const
+{
+    found->clear();
+    if(node.empty()) return;
+
+    std::vector<int> stack;
+    stack.push_back(0);
+    while(!stack.empty()) {
+        int i = stack.back();
+        stack.pop_back();
+        const Node &n = node[i];
+        if(!LineNearBox(n.max, n.min, a, b, asSegment)) continue;
+        if(n.right < 0) {
+            for(int j = n.start; j < n.end; j++) {
+                int k = item[j];
+                if(!LineNearBox(boxMax[k], boxMin[k], a, b, asSegment)) continue;
+                found->push_back(k);
+            }
+        } else {
+            stack.push_back(n.right);
+            stack.push_back(i + 1);
         }
-    } else {
-        STriangleLl *tn = STriangleLl::Alloc();
-        tn->tri = tr;
-        tn->next = tris;
-        tris = tn;
     }
+    std::sort(found->begin(), found->end());
 }
 
-void SKdNode::MakeMeshInto(SMesh *m) const {
-    if(gt) gt->MakeMeshInto(m);
-    if(lt) lt->MakeMeshInto(m);
+void SBvh::Clear() {
+    node.clear();
+    item.clear();
+    boxMax.clear();
+    boxMin.clear();
+}
 
-    STriangleLl *ll;
-    for(ll = tris; ll; ll = ll->next) {
-        if(ll->tri->tag) continue;
 
-        m->AddTriangle(ll->tri);
-        ll->tri->tag = 1;
+//-----------------------------------------------------------------------------
+// Copy the triangles of a mesh, and build our hierarchy over them.
+//-----------------------------------------------------------------------------
+void SMeshBvh::MakeFromCopyOf(const SMesh *m) {
+    Clear();
+    tri.reserve(m->l.n);
+    for(const STriangle &tr : m->l) {
+        tri.push_back(tr);
     }
+    more.assign(tri.size(), -1);
+
+    std::vector<Vector> max(tri.size()), min(tri.size());
+#pragma omp parallel for
+    for(int i = 0; i < (int)tri.size(); i++) {
+        max[i] = min[i] = tri[i].a;
+        tri[i].b.MakeMaxMin(&max[i], &min[i]);
+        tri[i].c.MakeMaxMin(&max[i], &min[i]);
+    }
+    bvh.Build(max, min);
 }
 
-void SKdNode::ListTrianglesInto(std::vector<STriangle *> *tl) const {
-    if(gt) gt->ListTrianglesInto(tl);
-    if(lt) lt->ListTrianglesInto(tl);
+void SMeshBvh::MakeMeshInto(SMesh *m) const {
+    for(const STriangle &tr : tri) {
+        m->AddTriangle(&tr);
+    }
+}
 
-    STriangleLl *ll;
-    for(ll = tris; ll; ll = ll->next) {
-        if(ll->tri->tag) continue;
+void SMeshBvh::Clear() {
+    tri.clear();
+    more.clear();
+    bvh.Clear();
+}
 
-        tl->push_back(ll->tri);
-        ll->tri->tag = 1;
-    }
+//-----------------------------------------------------------------------------
+// The triangles whose boxes come within KDTREE_EPS of the given box; but not
+// the pieces split from them, which the caller has to follow through more.
+//-----------------------------------------------------------------------------
+void SMeshBvh::FindTrianglesNear(Vector max, Vector min, std::vector<int> *found) const {
+    Vector pad = Vector::From(KDTREE_EPS, KDTREE_EPS, KDTREE_EPS);
+    bvh.FindOverlapping(max.Plus(pad), min.Minus(pad), found);
 }
 
 //-----------------------------------------------------------------------------
 // If any triangles in the mesh have an edge that goes through v (but not
 // a vertex at v), then split those triangles so that they now have a vertex
-// there. The existing triangle is modified, and the new triangle appears
-// in extras.
+// there. The existing triangle is modified, and the new triangle goes with
+// it in more.
 //-----------------------------------------------------------------------------
-void SKdNode::SnapToVertex(Vector v, SMesh *extras) {
-    if(gt && lt) {
-        double vc = v.Element(which);
-        if(vc < c + KDTREE_EPS) {
-            lt->SnapToVertex(v, extras);
-        }
-        if(vc > c - KDTREE_EPS) {
-            gt->SnapToVertex(v, extras);
-        }
-        // Nothing bad happens if the triangle to be split appears in both
-        // branches; the first call will split the triangle, so that the
-        // second call will do nothing, because the modified triangle will
-        // already contain v
-    } else {
-        STriangleLl *ll;
-        for(ll = tris; ll; ll = ll->next) {
-            STriangle *tr = ll->tri;
+void SMeshBvh::SnapToVertex(Vector v) {
+    std::vector<int> near;
+    FindTrianglesNear(v, v, &near);
+    // The pieces that we split off, and the triangles that they came from;
+    // added once we're done, so that we don't look at them again now.
+    std::vector<std::pair<int, STriangle>> extras;
+    for(int first : near) {
+        for(int i = first; i >= 0; i = more[i]) {
+            STriangle *tr = &tri[i];
 
             // Do a cheap bbox test first
             int k;
@@ -624,50 +1071,45 @@ void SKdNode::SnapToVertex(Vector v, SMesh *extras) {
 
             if(v.OnLineSegment(tr->a, tr->b)) {
                 STriangle nt = STriangle::From(tr->meta, tr->a, v, tr->c);
-                extras->AddTriangle(&nt);
+                extras.emplace_back(i, nt);
                 tr->a = v;
                 continue;
             }
             if(v.OnLineSegment(tr->b, tr->c)) {
                 STriangle nt = STriangle::From(tr->meta, tr->b, v, tr->a);
-                extras->AddTriangle(&nt);
+                extras.emplace_back(i, nt);
                 tr->b = v;
                 continue;
             }
             if(v.OnLineSegment(tr->c, tr->a)) {
                 STriangle nt = STriangle::From(tr->meta, tr->c, v, tr->b);
-                extras->AddTriangle(&nt);
+                extras.emplace_back(i, nt);
                 tr->c = v;
                 continue;
             }
         }
     }
+
+    for(auto &e : extras) {
+        int j = (int)tri.size();
+        tri.push_back(e.second);
+        more.push_back(more[e.first]);
+        more[e.first] = j;
+    }
 }
 
 //-----------------------------------------------------------------------------
 // Snap to each vertex of each triangle of the given mesh. If the given mesh
-// is identical to the mesh used to make this kd tree, then the result should
-// be a vertex-to-vertex mesh.
+// is identical to the mesh used to make this hierarchy, then the result
+// should be a vertex-to-vertex mesh.
 //-----------------------------------------------------------------------------
-void SKdNode::SnapToMesh(SMesh *m) {
-    int i, j, k;
-    for(i = 0; i < m->l.n; i++) {
-        STriangle *tr = &(m->l[i]);
-        if(tr->IsDegenerate()) {
+void SMeshBvh::SnapToMesh(const SMesh *m) {
+    for(const STriangle &tr : m->l) {
+        if(tr.IsDegenerate()) {
             continue;
         }
-        for(j = 0; j < 3; j++) {
-            Vector v = tr->vertices[j];
-
-            SMesh extra = {};
-            SnapToVertex(v, &extra);
-
-            for(k = 0; k < extra.l.n; k++) {
-                STriangle *tra = (STriangle *)AllocTemporary(sizeof(*tra));
-                *tra = extra.l[k];
-                AddTriangle(tra);
-            }
-            extra.Clear();
+        for(int j = 0; j < 3; j++) {
+            SnapToVertex(tr.vertices[j]);
         }
     }
 }
@@ -677,7 +1119,7 @@ void SKdNode::SnapToMesh(SMesh *m) {
 // them for occlusion. sel is both our input and our output. tag indicates
 // whether an edge is occluded.
 //-----------------------------------------------------------------------------
-void SKdNode::SplitLinesAgainstTriangle(SEdgeList *sel, STriangle *tr) const {
+void SMeshBvh::SplitLinesAgainstTriangle(SEdgeList *sel, const STriangle *tr) {
     SEdgeList seln = {};
 
     Vector tn = tr->Normal().WithMagnitude(1);
@@ -792,35 +1234,131 @@ void SKdNode::SplitLinesAgainstTriangle(SEdgeList *sel, STriangle *tr) const {
 // Given an edge orig, occlusion test it against our mesh. We output an edge
 // list in sel, where only invisible portions of the edge are tagged.
 //-----------------------------------------------------------------------------
-void SKdNode::OcclusionTestLine(SEdge orig, SEdgeList *sel, int cnt) const {
-    if(gt && lt) {
-        double ac = (orig.a).Element(which),
-               bc = (orig.b).Element(which);
-        // We can ignore triangles that are separated in x or y, but triangles
-        // that are separated in z may still contribute
-        if(ac < c + KDTREE_EPS ||
-           bc < c + KDTREE_EPS ||
-           which == 2)
-        {
-            lt->OcclusionTestLine(orig, sel, cnt);
+void SMeshBvh::OcclusionTestLine(SEdge orig, SEdgeList *sel) const {
+    // We can ignore triangles that are separated in x or y, but triangles
+    // that are separated in z may still contribute
+    Vector max = orig.a, min = orig.a;
+    orig.b.MakeMaxMin(&max, &min);
+    max.z = VERY_POSITIVE;
+    min.z = VERY_NEGATIVE;
+    std::vector<int> near;
+    FindTrianglesNear(max, min, &near);
+    for(int first : near) {
+        for(int i = first; i >= 0; i = more[i]) {
+            SplitLinesAgainstTriangle(sel, &tri[i]);
         }
-        if(ac > c - KDTREE_EPS ||
-           bc > c - KDTREE_EPS ||
-           which == 2)
-        {
-            gt->OcclusionTestLine(orig, sel, cnt);
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Classify a point against the closed mesh. If it lies on a triangle, then
+// that triangle's normal decides; and if on more than one, then the largest
+// of them, since the normals of the small ones aren't to be trusted.
+//-----------------------------------------------------------------------------
+SMeshBvh::Class SMeshBvh::ClassifyPoint(Vector p, Vector n) const {
+    bool onFace = false, sameNormal = false;
+    double maxNormalMag = -1;
+
+    std::vector<int> near;
+    FindTrianglesNear(p, p, &near);
+    for(int first : near) {
+        for(int i = first; i >= 0; i = more[i]) {
+            const STriangle *tr = &tri[i];
+            Vector trn = tr->Normal();
+            if(trn.Magnitude() < LENGTH_EPS*LENGTH_EPS) continue;
+            if(fabs(trn.WithMagnitude(1).Dot(p.Minus(tr->a))) > LENGTH_EPS) continue;
+            if(!tr->ContainsPoint(p)) continue;
+
+            onFace = true;
+            if(trn.Magnitude() > maxNormalMag) {
+                sameNormal = n.Dot(trn) > 0;
+                maxNormalMag = trn.Magnitude();
+            }
         }
-    } else {
-        STriangleLl *ll;
-        for(ll = tris; ll; ll = ll->next) {
-            STriangle *tr = ll->tri;
+    }
 
-            if(tr->tag == cnt) continue;
+    if(onFace) {
+        return sameNormal ? Class::COINC_SAME : Class::COINC_OPP;
+    }
+    int winding;
+    if(!WindingNumberAt(p, &winding)) {
+        return Class::AMBIGUOUS;
+    }
+    return (winding > 0) ? Class::INSIDE : Class::OUTSIDE;
+}
 
-            SplitLinesAgainstTriangle(sel, tr);
-            tr->tag = cnt;
+//-----------------------------------------------------------------------------
+// The number of times that the mesh winds around a point, counted along a ray
+// from it: plus one for each triangle that the ray leaves through, minus one
+// for each that it enters through. That's one inside a closed mesh, and zero
+// outside, but more where the solids of an assembly overlap. A ray that
+// passes too close to an edge or a vertex could miscount, so then we try
+// another direction; and if every one of them does, then we return false.
+//-----------------------------------------------------------------------------
+bool SMeshBvh::WindingNumberAt(Vector p, int *winding) const {
+    // Skewed, so that they're unlikely to run along the edges of a model
+    const Vector skewed[] = {
+        Vector::From( 0.5366, 0.6123, 0.5806),
+        Vector::From(-0.7071, 0.3152, 0.6330),
+        Vector::From( 0.2417,-0.8660, 0.4377),
+    };
+    // And if all of those are unlucky, then a spiral over the sphere, with
+    // the golden angle between turns; still deterministic.
+    const int spiral = 16;
+    const double tol = 1e-9;
+
+    *winding = 0;
+    if(bvh.node.empty()) return true;
+    // Far enough to leave the mesh's bounding box in any direction
+    const SBvh::Node &root = bvh.node[0];
+    double far = (root.max.Minus(root.min)).Magnitude() +
+                 (p.Minus((root.max.Plus(root.min)).ScaledBy(0.5))).Magnitude();
+
+    std::vector<int> near;
+    for(int k = 0; k < 3 + spiral; k++) {
+        Vector dir;
+        if(k < 3) {
+            dir = skewed[k].WithMagnitude(1);
+        } else {
+            double z   = 1 - (2*(k - 3) + 1) / (double)spiral,
+                   r   = sqrt(1 - z*z),
+                   phi = (k - 3) * PI * (3 - sqrt(5.0)) + 0.1;
+            dir = Vector::From(r*cos(phi), r*sin(phi), z);
         }
+        bvh.FindNearLine(p, p.Plus(dir.ScaledBy(far)), /*asSegment=*/true, &near);
+
+        *winding = 0;
+        bool ambiguous = false;
+        for(int first : near) {
+            if(ambiguous) break;
+            for(int i = first; i >= 0 && !ambiguous; i = more[i]) {
+                // As in STriangle::Raytrace(), but from both sides
+                const STriangle *tr = &tri[i];
+                Vector edge1 = tr->b.Minus(tr->a),
+                       edge2 = tr->c.Minus(tr->a);
+                Vector pvec = dir.Cross(edge2);
+                double det = edge1.Dot(pvec);
+                if(fabs(det) < LENGTH_EPS*LENGTH_EPS) continue;
+
+                Vector tvec = p.Minus(tr->a);
+                double u = tvec.Dot(pvec) / det;
+                Vector qvec = tvec.Cross(edge1);
+                double v = dir.Dot(qvec) / det;
+                if(u < -tol || v < -tol || u + v > 1 + tol) continue;
+                double t = edge2.Dot(qvec) / det;
+                if(t < -LENGTH_EPS) continue;
+
+                if(u < tol || v < tol || u + v > 1 - tol || t < LENGTH_EPS) {
+                    ambiguous = true;
+                } else {
+                    // The normal is edge1 x edge2, so det < 0 when we leave.
+                    *winding += (det < 0) ? 1 : -1;
+                }
+            }
+        }
+        if(!ambiguous) return true;
     }
+    return false;
 }
 
 //-----------------------------------------------------------------------------
@@ -832,105 +1370,86 @@ void SKdNode::OcclusionTestLine(SEdge orig, SEdgeList *sel, int cnt) const {
 // if coplanarIsInter then we count the edge as intersecting if it's coplanar
 // with a triangle in the mesh, otherwise not.
 //-----------------------------------------------------------------------------
-void SKdNode::FindEdgeOn(Vector a, Vector b, int cnt, bool coplanarIsInter,
-                         EdgeOnInfo *info) const
+void SMeshBvh::FindEdgeOn(Vector a, Vector b, bool coplanarIsInter,
+                          EdgeOnInfo *info) const
 {
-    if(gt && lt) {
-        double ac = a.Element(which),
-               bc = b.Element(which);
-        if(ac < c + KDTREE_EPS ||
-           bc < c + KDTREE_EPS)
-        {
-            lt->FindEdgeOn(a, b, cnt, coplanarIsInter, info);
-        }
-        if(ac > c - KDTREE_EPS ||
-           bc > c - KDTREE_EPS)
-        {
-            gt->FindEdgeOn(a, b, cnt, coplanarIsInter, info);
-        }
-        return;
-    }
-
-    // We are a leaf node; so we iterate over all the triangles in our
-    // linked list.
-    STriangleLl *ll;
-    for(ll = tris; ll; ll = ll->next) {
-        STriangle *tr = ll->tri;
-
-        if(tr->tag == cnt) continue;
-
-        // Test if this triangle matches up with the given edge
-        if((a.Equals(tr->b) && b.Equals(tr->a)) ||
-           (a.Equals(tr->c) && b.Equals(tr->b)) ||
-           (a.Equals(tr->a) && b.Equals(tr->c)))
-        {
-            info->count++;
-            // Record whether this triangle is front- or back-facing.
-            if(tr->Normal().z > LENGTH_EPS) {
-                info->frontFacing = true;
-            } else {
-                info->frontFacing = false;
-            }
-            // Record the triangle
-            info->tr = tr;
-            // And record which vertices a and b correspond to
-            info->ai = a.Equals(tr->a) ? 0 : (a.Equals(tr->b) ? 1 : 2);
-            info->bi = b.Equals(tr->a) ? 0 : (b.Equals(tr->b) ? 1 : 2);
-        } else if(((a.Equals(tr->a) && b.Equals(tr->b)) ||
-                   (a.Equals(tr->b) && b.Equals(tr->c)) ||
-                   (a.Equals(tr->c) && b.Equals(tr->a))))
-        {
-            // It's an edge of this triangle, okay.
-        } else {
-            // Check for self-intersection
-            Vector n = (tr->Normal()).WithMagnitude(1);
-            double d = (tr->a).Dot(n);
-            double pa = a.Dot(n) - d, pb = b.Dot(n) - d;
-            // It's an intersection if neither point lies in-plane,
-            // and the edge crosses the plane (should handle in-plane
-            // intersections separately but don't yet).
-            if((pa < -LENGTH_EPS || pa > LENGTH_EPS) &&
-               (pb < -LENGTH_EPS || pb > LENGTH_EPS) &&
-               (pa*pb < 0))
+    Vector max = a, min = a;
+    b.MakeMaxMin(&max, &min);
+    std::vector<int> near;
+    FindTrianglesNear(max, min, &near);
+    for(int k : near) {
+        for(int i = k; i >= 0; i = more[i]) {
+            const STriangle *tr = &tri[i];
+
+            // Test if this triangle matches up with the given edge
+            if((a.Equals(tr->b) && b.Equals(tr->a)) ||
+               (a.Equals(tr->c) && b.Equals(tr->b)) ||
+               (a.Equals(tr->a) && b.Equals(tr->c)))
             {
-                // The edge crosses the plane of the triangle; now see if
-                // it crosses inside the triangle.
-                if(tr->ContainsPointProjd(b.Minus(a), a)) {
-                    if(coplanarIsInter) {
-                        info->intersectsMesh = true;
-                    } else {
-                        Vector p = Vector::AtIntersectionOfPlaneAndLine(
-                                                n, d, a, b, NULL);
-                        Vector ta = tr->a,
-                               tb = tr->b,
-                               tc = tr->c;
-                        if((p.DistanceToLine(ta, tb.Minus(ta)) < LENGTH_EPS) ||
-                           (p.DistanceToLine(tb, tc.Minus(tb)) < LENGTH_EPS) ||
-                           (p.DistanceToLine(tc, ta.Minus(tc)) < LENGTH_EPS))
-                        {
-                            // Intersection lies on edge. This happens when
-                            // our edge is from a triangle coplanar with
-                            // another triangle in the mesh. We don't test
-                            // the edge against triangles whose plane contains
-                            // that edge, but we do end up testing against
-                            // the coplanar triangle's neighbours, which we
-                            // will intersect on their edges.
-                        } else {
+                info->count++;
+                // Record whether this triangle is front- or back-facing.
+                if(tr->Normal().z > LENGTH_EPS) {
+                    info->frontFacing = true;
+                } else {
+                    info->frontFacing = false;
+                }
+                // Record the triangle
+                info->tr = tr;
+                // And record which vertices a and b correspond to
+                info->ai = a.Equals(tr->a) ? 0 : (a.Equals(tr->b) ? 1 : 2);
+                info->bi = b.Equals(tr->a) ? 0 : (b.Equals(tr->b) ? 1 : 2);
+            } else if(((a.Equals(tr->a) && b.Equals(tr->b)) ||
+                       (a.Equals(tr->b) && b.Equals(tr->c)) ||
+                       (a.Equals(tr->c) && b.Equals(tr->a))))
+            {
+                // It's an edge of this triangle, okay.
+            } else {
+                // Check for self-intersection
+                Vector n = (tr->Normal()).WithMagnitude(1);
+                double d = (tr->a).Dot(n);
+                double pa = a.Dot(n) - d, pb = b.Dot(n) - d;
+                // It's an intersection if neither point lies in-plane,
+                // and the edge crosses the plane (should handle in-plane
+                // intersections separately but don't yet).
+                if((pa < -LENGTH_EPS || pa > LENGTH_EPS) &&
+                   (pb < -LENGTH_EPS || pb > LENGTH_EPS) &&
+                   (pa*pb < 0))
+                {
+                    // The edge crosses the plane of the triangle; now see if
+                    // it crosses inside the triangle.
+                    if(tr->ContainsPointProjd(b.Minus(a), a)) {
+                        if(coplanarIsInter) {
                             info->intersectsMesh = true;
+                        } else {
+                            Vector p = Vector::AtIntersectionOfPlaneAndLine(
+                                                    n, d, a, b, NULL);
+                            Vector ta = tr->a,
+                                   tb = tr->b,
+                                   tc = tr->c;
+                            if((p.DistanceToLine(ta, tb.Minus(ta)) < LENGTH_EPS) ||
+                               (p.DistanceToLine(tb, tc.Minus(tb)) < LENGTH_EPS) ||
+                               (p.DistanceToLine(tc, ta.Minus(tc)) < LENGTH_EPS))
+                            {
+                                // Intersection lies on edge. This happens when
+                                // our edge is from a triangle coplanar with
+                                // another triangle in the mesh. We don't test
+                                // the edge against triangles whose plane contains
+                                // that edge, but we do end up testing against
+                                // the coplanar triangle's neighbours, which we
+                                // will intersect on their edges.
+                            } else {
+                                info->intersectsMesh = true;
+                            }
                         }
                     }
                 }
             }
         }
-
-        // Ensure that we don't count this triangle twice if it appears
-        // in two buckets of the kd tree.
-        tr->tag = cnt;
     }
 }
 
-static bool CheckAndAddTrianglePair(std::set<std::pair<STriangle *, STriangle *>> *pairs,
-                                    STriangle *a, STriangle *b)
+static bool CheckAndAddTrianglePair(std::set<std::pair<const STriangle *, const STriangle *>> *pairs,
+                                    const STriangle *a, const STriangle *b)
 {
     if(pairs->find(std::make_pair(a, b)) != pairs->end() ||
        pairs->find(std::make_pair(b, a)) != pairs->end())
@@ -949,33 +1468,29 @@ static bool CheckAndAddTrianglePair(std::set<std::pair<STriangle *, STriangle *>
 //    * emphasized edges (i.e., edges where a triangle from one face joins
 //      a triangle from a different face)
 //-----------------------------------------------------------------------------
-void SKdNode::MakeCertainEdgesInto(SEdgeList *sel, EdgeKind how, bool coplanarIsInter,
+void SMeshBvh::MakeCertainEdgesInto(SEdgeList *sel, EdgeKind how, bool coplanarIsInter,
                                    bool *inter, bool *leaky, int auxA) const
 {
     if(inter) *inter = false;
     if(leaky) *leaky = false;
 
-    std::vector<STriangle *> tris;
-    ClearTags();
-    ListTrianglesInto(&tris);
-
-    std::set<std::pair<STriangle *, STriangle *>> edgeTris;
-    int cnt = 1234;
-    for(STriangle *tr : tris) {
+    std::set<std::pair<const STriangle *, const STriangle *>> edgeTris;
+    for(const STriangle &t : tri) {
+        const STriangle *tr = &t;
         for(int j = 0; j < 3; j++) {
             Vector a = tr->vertices[j];
             Vector b = tr->vertices[(j + 1) % 3];
 
-            SKdNode::EdgeOnInfo info = {};
-            FindEdgeOn(a, b, cnt, coplanarIsInter, &info);
+            EdgeOnInfo info = {};
+            FindEdgeOn(a, b, coplanarIsInter, &info);
 
             switch(how) {
                 case EdgeKind::NAKED_OR_SELF_INTER:
                     // there should be one anti-parllel edge
                     if(info.count != 1) {
                         // but there may be multiple parallel coincident edges
-                        SKdNode::EdgeOnInfo parallelInfo = {};
-                        FindEdgeOn(b, a, -cnt, coplanarIsInter, &parallelInfo);
+                        EdgeOnInfo parallelInfo = {};
+                        FindEdgeOn(b, a, coplanarIsInter, &parallelInfo);
                         if (info.count != parallelInfo.count) {
                             sel->AddEdge(a, b, auxA);
                             if(leaky) *leaky = true;
@@ -1037,28 +1552,21 @@ void SKdNode::MakeCertainEdgesInto(SEdgeList *sel, EdgeKind how, bool coplanarIs
                     }
                     break;
             }
-
-            cnt++;
         }
     }
 }
 
-void SKdNode::MakeOutlinesInto(SOutlineList *sol, EdgeKind edgeKind) const
+void SMeshBvh::MakeOutlinesInto(SOutlineList *sol, EdgeKind edgeKind) const
 {
-    std::vector<STriangle *> tris;
-    ClearTags();
-    ListTrianglesInto(&tris);
-
-    std::set<std::pair<STriangle *, STriangle *>> edgeTris;
-    int cnt = 1234;
-    for(STriangle *tr : tris) {
+    std::set<std::pair<const STriangle *, const STriangle *>> edgeTris;
+    for(const STriangle &t : tri) {
+        const STriangle *tr = &t;
         for(int j = 0; j < 3; j++) {
             Vector a = tr->vertices[j];
             Vector b = tr->vertices[(j + 1) % 3];
 
-            SKdNode::EdgeOnInfo info = {};
-            FindEdgeOn(a, b, cnt, /*coplanarIsInter=*/false, &info);
-            cnt++;
+            EdgeOnInfo info = {};
+            FindEdgeOn(a, b, /*coplanarIsInter=*/false, &info);
             if(info.count != 1) continue;
             if(CheckAndAddTrianglePair(&edgeTris, tr, info.tr))
                 continue;
@@ -1215,3 +1723,112 @@ double SMesh::CalculateSurfaceArea(const std::vector<uint32_t> &faces) const {
     }
     return area;
 }
+
+//-----------------------------------------------------------------------------
+// The compact, indexed form of a mesh. Vertices and normals are welded in
+// the same way as elsewhere, to within LENGTH_EPS; the normals are made unit
+// first, so that's an angle. Or they're welded only when bit for bit the same.
+//-----------------------------------------------------------------------------
+struct VectorExactHash {
+    size_t operator()(const Vector &v) const {
+        ContentHasher hash;
+        hash.Add(&v, sizeof(v));
+        return (size_t)hash.value;
+    }
+};
+struct VectorExactPred {
+    bool operator()(const Vector &a, const Vector &b) const {
+        return memcmp(&a, &b, sizeof(Vector)) == 0;
+    }
+};
+
+void SCompactMesh::Clear() {
+    vertices.clear();
+    vertices.shrink_to_fit();
+    normals.clear();
+    normals.shrink_to_fit();
+    metas.clear();
+    metas.shrink_to_fit();
+    triangles.clear();
+    triangles.shrink_to_fit();
+}
+
+template<class Hash, class Pred>
+static void MakeCompactFrom(SCompactMesh *cm, const SMesh *m, bool unitNormals) {
+    std::unordered_map<Vector, uint32_t, Hash, Pred> vertexIndex, normalIndex;
+    std::unordered_map<uint64_t, uint32_t> metaIndex;
+
+    auto indexFor = [](Vector v, std::vector<double> *coords,
+                       std::unordered_map<Vector, uint32_t, Hash, Pred> *index) {
+        auto it = index->emplace(v, (uint32_t)(coords->size() / 3));
+        if(it.second) {
+            coords->push_back(v.x);
+            coords->push_back(v.y);
+            coords->push_back(v.z);
+        }
+        return it.first->second;
+    };
+
+    cm->triangles.reserve(cm->triangles.size() + m->l.n);
+    for(const STriangle &tr : m->l) {
+        SCompactMesh::Triangle t;
+        for(int i = 0; i < 3; i++) {
+            Vector n = tr.normals[i];
+            // A zero normal means that the triangle has none of its own.
+            if(unitNormals && !n.EqualsExactly(Vector::From(0, 0, 0))) {
+                n = n.WithMagnitude(1);
+            }
+            t.vertices[i] = indexFor(tr.vertices[i], &cm->vertices, &vertexIndex);
+            t.normals[i]  = indexFor(n, &cm->normals, &normalIndex);
+        }
+        uint64_t mk = ((uint64_t)tr.meta.face << 32) | tr.meta.color.ToPackedInt();
+        auto it = metaIndex.emplace(mk, (uint32_t)cm->metas.size());
+        if(it.second) cm->metas.push_back(tr.meta);
+        t.meta = it.first->second;
+        cm->triangles.push_back(t);
+    }
+    cm->vertices.shrink_to_fit();
+    cm->normals.shrink_to_fit();
+}
+
+void SCompactMesh::MakeFromCopyOf(const SMesh *m, bool exact) {
+    if(exact) {
+        MakeCompactFrom<VectorExactHash, VectorExactPred>(this, m, /*unitNormals=*/false);
+    } else {
+        MakeCompactFrom<VectorHash, VectorPred>(this, m, /*unitNormals=*/true);
+    }
+}
+
+STriangle SCompactMesh::TriangleAt(size_t i) const {
+    const Triangle &t = triangles[i];
+    STriangle tr = {};
+    tr.meta = metas[t.meta];
+    for(int j = 0; j < 3; j++) {
+        tr.vertices[j] = Vertex(t.vertices[j]);
+        tr.normals[j]  = Normal(t.normals[j]);
+    }
+    return tr;
+}
+
+void SCompactMesh::MakeMeshInto(SMesh *m) const {
+    m->l.ReserveMore((int)triangles.size());
+    for(size_t i = 0; i < triangles.size(); i++) {
+        STriangle tr = TriangleAt(i);
+        m->AddTriangle(&tr);
+    }
+}
+
+void SCompactMesh::GetBounding(Vector *vmax, Vector *vmin) const {
+    *vmin = Vector::From( 1e12,  1e12,  1e12);
+    *vmax = Vector::From(-1e12, -1e12, -1e12);
+    // Every vertex belongs to some triangle, so no need to go through those.
+    for(uint32_t i = 0; i < VertexCount(); i++) {
+        Vector v = Vertex(i);
+        vmax->x = max(vmax->x, v.x);
+        vmax->y = max(vmax->y, v.y);
+        vmax->z = max(vmax->z, v.z);
+        vmin->x = min(vmin->x, v.x);
+        vmin->y = min(vmin->y, v.y);
+        vmin->z = min(vmin->z, v.z);
+    }
+}
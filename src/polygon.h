@@ -13,6 +13,7 @@ class SPolygon;
 class SContour;
 class SMesh;
 class SBsp3;
+class SMeshBvh;
 class SOutlineList;
 
 enum class EarType : uint32_t {
@@ -135,7 +136,7 @@ public:
     bool IsEar(int bp, double scaledEps) const;
     bool BridgeToContour(SContour *sc, SEdgeList *el, List<Vector> *vl);
     void ClipEarInto(SMesh *m, int bp, double scaledEps);
-    void UvTriangulateInto(SMesh *m, SSurface *srf);
+    void UvTriangulateInto(SMesh *m, SSurface *srf, double chordTol);
 };
 
 typedef struct {
@@ -160,8 +161,8 @@ public:
     bool IsEmpty() const;
     Vector AnyPoint() const;
     void OffsetInto(SPolygon *dest, double r) const;
-    void UvTriangulateInto(SMesh *m, SSurface *srf);
-    void UvGridTriangulateInto(SMesh *m, SSurface *srf);
+    void UvTriangulateInto(SMesh *m, SSurface *srf, double chordTol);
+    void UvGridTriangulateInto(SMesh *m, SSurface *srf, double chordTol);
     void TriangulateInto(SMesh *m) const;
     void InverseTransformInto(SPolygon *sp, Vector u, Vector v, Vector n) const;
 };
@@ -232,8 +233,10 @@ public:
 
     static SBsp3 *Alloc();
     static SBsp3 *FromMesh(const SMesh *m);
+    static SBsp3 *FromMeshIncrementally(const SMesh *m);
 
     Vector IntersectionWith(Vector a, Vector b) const;
+    BspClass ClassifyPoint(Vector p) const;
 
     void InsertHow(BspClass how, STriangle *str, SMesh *instead);
     void Insert(STriangle *str, SMesh *instead);
@@ -246,6 +249,15 @@ public:
     void InsertInPlane(bool pos2, STriangle *tr, SMesh *m);
 
     void GenerateInPaintOrder(SMesh *m) const;
+
+    class Stats {
+    public:
+        int     planes;     // nodes that split space
+        int     fragments;  // triangles, after splitting, with coplanar ones
+        int     depth;      // of the deepest plane
+        double  meanDepth;  // over the fragments
+    };
+    void GetStats(Stats *stats, int depth = 1) const;
 };
 
 class SMesh {
@@ -257,6 +269,9 @@ public:
     bool    keepCoplanar;
     bool    atLeastOneDiscarded;
     bool    isTransparent;
+    // Whether Booleans split triangles where they intersect the other mesh's
+    // and classify the pieces by ray casting, instead of going through a BSP
+    bool    indexedBoolean = false;
 
     void Clear();
     void AddTriangle(const STriangle *st);
@@ -268,7 +283,9 @@ public:
 
     void Simplify(int start);
 
+    void AddAgainst(SMesh *srcm, SMesh *other);
     void AddAgainstBsp(SMesh *srcm, SBsp3 *bsp3);
+    void AddAgainstMesh(SMesh *srcm, const SMeshBvh *other);
     void MakeFromUnionOf(SMesh *a, SMesh *b);
     void MakeFromDifferenceOf(SMesh *a, SMesh *b);
     void MakeFromIntersectionOf(SMesh *a, SMesh *b);
@@ -288,20 +305,47 @@ public:
 
     bool IsEmpty() const;
     void RemapFaces(Group *g, int remap);
+    uint64_t ContentHash() const;
 
     uint32_t FirstIntersectionWith(Point2d mp) const;
 
     Vector GetCenterOfMass() const;
 };
 
-// A linked list of triangles
-class STriangleLl {
+// The same triangles as an SMesh, but with each distinct vertex and normal
+// stored just once, and the triangles referring to them (and to their
+// STriMeta) by index; a small fraction of the size, for code that only
+// reads the mesh. The triangles' tags are not kept. Vertices are welded to
+// within LENGTH_EPS, and unit normals likewise; or, if exact, only where
+// they're identical, so that MakeMeshInto() gives back exactly the same
+// triangles.
+class SCompactMesh {
 public:
-    STriangle       *tri;
+    struct Triangle {
+        uint32_t    vertices[3];
+        uint32_t    normals[3];
+        uint32_t    meta;
+    };
 
-    STriangleLl     *next;
+    std::vector<double>     vertices;   // x, y, z of each vertex in turn
+    std::vector<double>     normals;    // likewise, for each normal
+    std::vector<STriMeta>   metas;
+    std::vector<Triangle>   triangles;
+
+    void Clear();
+    void MakeFromCopyOf(const SMesh *m, bool exact=false);
+    void MakeMeshInto(SMesh *m) const;
 
-    static STriangleLl *Alloc();
+    size_t Size() const { return triangles.size(); }
+    size_t VertexCount() const { return vertices.size() / 3; }
+    Vector Vertex(uint32_t i) const {
+        return Vector::From(vertices[3*i], vertices[3*i+1], vertices[3*i+2]);
+    }
+    Vector Normal(uint32_t i) const {
+        return Vector::From(normals[3*i], normals[3*i+1], normals[3*i+2]);
+    }
+    STriangle TriangleAt(size_t i) const;
+    void GetBounding(Vector *vmax, Vector *vmin) const;
 };
 
 class SOutline {
@@ -323,44 +367,89 @@ public:
     void MakeFromCopyOf(SOutlineList *ol);
 };
 
-class SKdNode {
+// A bounding volume hierarchy over some boxes, like those of the surfaces
+// of a shell or the triangles of a mesh; it finds the boxes that might meet
+// a given box or line without testing them all. The boxes are referred to by
+// their index when built.
+class SBvh {
 public:
-    struct EdgeOnInfo {
-        int        count;
-        bool       frontFacing;
-        bool       intersectsMesh;
-        STriangle *tr;
-        int        ai;
-        int        bi;
+    struct Node {
+        Vector  max, min;
+        // The boxes under this node are item[start] ... item[end - 1]. The
+        // first child is the next node, and the second one is right; or, if
+        // right is -1, this is a leaf.
+        int     start, end;
+        int     right;
     };
+    std::vector<Node>   node;
+    std::vector<int>    item;
+    std::vector<Vector> boxMax, boxMin;
+
+    void Build(const std::vector<Vector> &max, const std::vector<Vector> &min);
+    int BuildNode(int start, int end, std::vector<Node> *into);
+    bool SplitItems(int start, int end, Vector max, Vector min, int *mid);
+    void GetBounding(int start, int end, Vector *max, Vector *min) const;
+    int Size() const { return (int)boxMax.size(); }
+
+    // The boxes that aren't disjoint from the given box, or that the line
+    // might pass through or near; in increasing order of index
+    void FindOverlapping(Vector max, Vector min, std::vector<int> *found) const;
+    void FindNearLine(Vector a, Vector b, bool asSegment,
+                      std::vector<int> *found) const;
 
-    int which;  // whether c is x, y, or z
-    double c;
-
-    SKdNode      *gt;
-    SKdNode      *lt;
+    void Clear();
+};
 
-    STriangleLl  *tris;
+// A copy of the triangles of a mesh, with a bounding volume hierarchy over
+// them; for the queries that would otherwise have to test each triangle
+// against every other one.
+class SMeshBvh {
+public:
+    struct EdgeOnInfo {
+        int              count;
+        bool             frontFacing;
+        bool             intersectsMesh;
+        const STriangle *tr;
+        int              ai;
+        int              bi;
+    };
 
-    static SKdNode *Alloc();
-    static SKdNode *From(SMesh *m);
-    static SKdNode *From(STriangleLl *tll);
+    std::vector<STriangle>  tri;
+    SBvh                    bvh;
+    // SnapToMesh() splits triangles. A piece split from tri[i] lies within
+    // the box that bvh has for tri[i], so it goes with that one; the pieces
+    // are tri[more[i]], tri[more[more[i]]], and so on until -1.
+    std::vector<int>        more;
 
-    void AddTriangle(STriangle *tr);
+    void MakeFromCopyOf(const SMesh *m);
     void MakeMeshInto(SMesh *m) const;
-    void ListTrianglesInto(std::vector<STriangle *> *tl) const;
-    void ClearTags() const;
+    void Clear();
+
+    void FindTrianglesNear(Vector max, Vector min, std::vector<int> *found) const;
 
-    void FindEdgeOn(Vector a, Vector b, int cnt, bool coplanarIsInter, EdgeOnInfo *info) const;
+    void FindEdgeOn(Vector a, Vector b, bool coplanarIsInter, EdgeOnInfo *info) const;
     void MakeCertainEdgesInto(SEdgeList *sel, EdgeKind how, bool coplanarIsInter,
                               bool *inter, bool *leaky, int auxA = 0) const;
     void MakeOutlinesInto(SOutlineList *sel, EdgeKind tagKind) const;
 
-    void OcclusionTestLine(SEdge orig, SEdgeList *sel, int cnt) const;
-    void SplitLinesAgainstTriangle(SEdgeList *sel, STriangle *tr) const;
+    // Whether a point is inside or outside the closed mesh, or on it (with a
+    // triangle whose normal is parallel or antiparallel to ours); or
+    // AMBIGUOUS, if no ray could tell, and the caller should ask a BSP.
+    enum class Class : uint32_t {
+        INSIDE     = 100,
+        OUTSIDE    = 200,
+        COINC_SAME = 300,
+        COINC_OPP  = 400,
+        AMBIGUOUS  = 500
+    };
+    Class ClassifyPoint(Vector p, Vector n) const;
+    bool WindingNumberAt(Vector p, int *winding) const;
+
+    void OcclusionTestLine(SEdge orig, SEdgeList *sel) const;
+    static void SplitLinesAgainstTriangle(SEdgeList *sel, const STriangle *tr);
 
-    void SnapToMesh(SMesh *m);
-    void SnapToVertex(Vector v, SMesh *extras);
+    void SnapToMesh(const SMesh *m);
+    void SnapToVertex(Vector v);
 };
 
 class PolylineBuilder {
@@ -262,10 +262,8 @@ void SurfaceRenderer::CullOccludedStrokes() {
     ConvertBeziersToEdges();
 
     // Remove hidden lines (on NORMAL layers), or remove visible lines (on OCCLUDED layers).
-    SKdNode *root = SKdNode::From(&mesh);
-    root->ClearTags();
-
-    int cnt = 1234;
+    SMeshBvh bvh = {};
+    bvh.MakeFromCopyOf(&mesh);
     for(auto &eit : edges) {
         hStroke hcs = eit.first;
         SEdgeList &el = eit.second;
@@ -278,7 +276,7 @@ void SurfaceRenderer::CullOccludedStrokes() {
         for(const SEdge &e : el.l) {
             SEdgeList oel = {};
             oel.AddEdge(e.a, e.b);
-            root->OcclusionTestLine(e, &oel, cnt);
+            bvh.OcclusionTestLine(e, &oel);
 
             if(stroke->layer == Layer::OCCLUDED) {
                 for(SEdge &oe : oel.l) {
@@ -293,7 +291,6 @@ void SurfaceRenderer::CullOccludedStrokes() {
             }
 
             oel.Clear();
-            cnt++;
         }
 
         el.l.Clear();
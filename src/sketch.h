@@ -190,6 +190,7 @@ public:
     struct {
         SolveResult         how;
         int                 dof;
+        int                 iterations;
         int                 findToFixTimeout;
         bool                timeout;
         List<hConstraint>   remove;
@@ -239,6 +240,8 @@ public:
     SMesh           runningMesh;
 
     bool            displayDirty;
+    // Whether displayMesh is just a coarse preview, still to be refined
+    bool            displayPreview;
     SMesh           displayMesh;
     SOutlineList    displayOutlines;
 
@@ -252,6 +255,13 @@ public:
 
     bool forceToMesh;
 
+    // How the Booleans are done, when this group's solid is a triangle mesh
+    enum class MeshBoolean : uint32_t {
+        BSP             = 0,
+        INDEXED         = 1
+    };
+    MeshBoolean meshBoolean;
+
     EntityMap remap;
 
     Platform::Path linkFile;
@@ -320,11 +330,11 @@ public:
     void GenerateShellAndMesh();
     template<class T> void GenerateForStepAndRepeat(T *steps, T *outs, Group::CombineAs forWhat);
     template<class T> void GenerateForBoolean(T *a, T *b, T *o, Group::CombineAs how);
-    void GenerateDisplayItems();
+    void GenerateDisplayItems(bool preview=false);
 
     enum class DrawMeshAs { DEFAULT, HOVERED, SELECTED };
     void DrawMesh(DrawMeshAs how, Canvas *canvas);
-    void Draw(Canvas *canvas);
+    void Draw(Canvas *canvas, bool preview=false);
     void DrawPolyError(Canvas *canvas);
     void DrawFilledPaths(Canvas *canvas);
     void DrawContourAreaLabels(Canvas *canvas);
@@ -83,6 +83,12 @@ void SolveSpaceUI::Init() {
     checkClosedContour = settings->ThawBool("CheckClosedContour", true);
     // Enable automatic constrains for lines
     automaticLineConstraints = settings->ThawBool("AutomaticLineConstraints", true);
+    // Solve independent parts of a sketch on several threads
+    solveInParallel = settings->ThawBool("SolveInParallel", true);
+    // Find the Jacobian by reverse-mode automatic differentiation
+    reverseModeJacobian = settings->ThawBool("ReverseModeJacobian", false);
+    // Damp the Newton steps of the solver
+    dampedSolver = settings->ThawBool("DampedSolver", false);
     // Draw closed polygons areas
     showContourAreas = settings->ThawBool("ShowContourAreas", false);
     // Export shaded triangles in a 2d view
@@ -131,6 +137,9 @@ void SolveSpaceUI::Init() {
     autosaveTimer = Platform::CreateTimer();
     autosaveTimer->onTimeout = std::bind(&SolveSpaceUI::Autosave, &SS);
 
+    refineTimer = Platform::CreateTimer();
+    refineTimer->onTimeout = std::bind(&SolveSpaceUI::RefineDisplay, &SS);
+
     // The default styles (colors, line widths, etc.) are also stored in the
     // configuration file, but we will automatically load those as we need
     // them.
@@ -264,6 +273,12 @@ void SolveSpaceUI::Exit() {
     settings->FreezeBool("ImmediatelyEditDimension", immediatelyEditDimension);
     // Enable automatic constrains for lines
     settings->FreezeBool("AutomaticLineConstraints", automaticLineConstraints);
+    // Solve independent parts of a sketch on several threads
+    settings->FreezeBool("SolveInParallel", solveInParallel);
+    // Find the Jacobian by reverse-mode automatic differentiation
+    settings->FreezeBool("ReverseModeJacobian", reverseModeJacobian);
+    // Damp the Newton steps of the solver
+    settings->FreezeBool("DampedSolver", dampedSolver);
     // Export shaded triangles in a 2d view
     settings->FreezeBool("ExportShadedTriangles", exportShadedTriangles);
     // Export pwl curves (instead of exact) always
@@ -310,6 +325,19 @@ void SolveSpaceUI::Refresh() {
     }
 }
 
+// Some groups were displayed with a coarse preview of their solid model, so
+// that the user saw something right away; now triangulate those properly.
+void SolveSpaceUI::RefineDisplay() {
+    // The center of mass came from the preview too.
+    centerOfMass.dirty = true;
+    for(Group &g : SK.group) {
+        if(g.displayPreview) {
+            g.GenerateDisplayItems(/*preview=*/false);
+        }
+    }
+    GW.Invalidate(/*clearPersistent=*/true);
+}
+
 void SolveSpaceUI::ScheduleGenerateAll() {
     scheduledGenerateAll = true;
     refreshTimer->RunAfterProcessingEvents();
@@ -324,6 +352,12 @@ void SolveSpaceUI::ScheduleAutosave() {
     autosaveTimer->RunAfter(autosaveInterval * 60 * 1000);
 }
 
+void SolveSpaceUI::ScheduleRefineDisplay() {
+    // Wait until the user pauses, so we don't refine anything that's about to
+    // change again anyway.
+    refineTimer->RunAfter(250);
+}
+
 double SolveSpaceUI::MmPerUnit() {
     switch(viewUnits) {
         case Unit::INCHES: return 25.4;
@@ -847,10 +881,14 @@ void SolveSpaceUI::MenuAnalyze(Command id) {
         case Command::INTERFERENCE: {
             SS.nakedEdges.Clear();
 
-            SMesh *m = &(SK.GetGroup(SS.GW.activeGroup)->displayMesh);
-            SKdNode *root = SKdNode::From(m);
+            // Not a coarse preview, if that's what we're displaying.
+            Group *g = SK.GetGroup(SS.GW.activeGroup);
+            g->GenerateDisplayItems();
+            SMesh *m = &(g->displayMesh);
+            SMeshBvh bvh = {};
+            bvh.MakeFromCopyOf(m);
             bool inters, leaks;
-            root->MakeCertainEdgesInto(&(SS.nakedEdges),
+            bvh.MakeCertainEdgesInto(&(SS.nakedEdges),
                 EdgeKind::SELF_INTER, /*coplanarIsInter=*/false, &inters, &leaks);
 
             SS.GW.Invalidate();
@@ -865,6 +903,7 @@ void SolveSpaceUI::MenuAnalyze(Command id) {
         }
 
         case Command::CENTER_OF_MASS: {
+            SK.GetGroup(SS.GW.activeGroup)->GenerateDisplayItems();
             SS.UpdateCenterOfMass();
             SS.centerOfMass.draw = true;
             SS.GW.Invalidate();
@@ -873,6 +912,7 @@ void SolveSpaceUI::MenuAnalyze(Command id) {
 
         case Command::VOLUME: {
             Group *g = SK.GetGroup(SS.GW.activeGroup);
+            g->GenerateDisplayItems();
             double totalVol = g->displayMesh.CalculateVolume();
             std::string msg = ssprintf(
                 _("The volume of the solid model is:\n\n"
@@ -900,6 +940,7 @@ void SolveSpaceUI::MenuAnalyze(Command id) {
             SS.GW.GroupSelection();
 
             if(gs.faces > 0) {
+                g->GenerateDisplayItems();
                 std::vector<uint32_t> faces;
                 faces.push_back(gs.face[0].v);
                 if(gs.faces > 1) faces.push_back(gs.face[1].v);
@@ -1012,10 +1053,12 @@ void SolveSpaceUI::ShowNakedEdges(bool reportOnlyWhenNotOkay) {
     SS.nakedEdges.Clear();
 
     Group *g = SK.GetGroup(SS.GW.activeGroup);
+    g->GenerateDisplayItems();
     SMesh *m = &(g->displayMesh);
-    SKdNode *root = SKdNode::From(m);
+    SMeshBvh bvh = {};
+    bvh.MakeFromCopyOf(m);
     bool inters, leaks;
-    root->MakeCertainEdgesInto(&(SS.nakedEdges),
+    bvh.MakeCertainEdgesInto(&(SS.nakedEdges),
         EdgeKind::NAKED_OR_SELF_INTER, /*coplanarIsInter=*/true, &inters, &leaks);
 
     if(reportOnlyWhenNotOkay && !inters && !leaks && SS.nakedEdges.l.IsEmpty()) {
@@ -1076,6 +1119,10 @@ PACKAGE_VERSION, 2022);
 
 void SolveSpaceUI::Clear() {
     sys.Clear();
+    shellBooleans.Clear();
+    meshBooleans.Clear();
+    intersections.Clear();
+    triangulations.Clear();
     for(int i = 0; i < MAX_UNDO; i++) {
         if(i < undo.cnt) undo.d[i].Clear();
         if(i < redo.cnt) redo.d[i].Clear();
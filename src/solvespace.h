@@ -22,8 +22,10 @@
 #include <cstdlib>
 #include <cstring>
 #include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <functional>
+#include <list>
 #include <locale>
 #include <map>
 #include <memory>
@@ -216,6 +218,14 @@ void Error(const char *fmt, ...);
 class System {
 public:
     enum { MAX_UNKNOWNS = 2048 };
+    // Subsystems with no more unknowns or equations than this are solved
+    // with dense matrices; at that size, the sparse solver's setup costs
+    // more than the factorization.
+    enum { DENSE_SIZE = 32 };
+    // Subsystems are only handed to other threads when at least two of them
+    // have this many equations; below that, starting the threads costs more
+    // than solving everything on this one.
+    enum { PARALLEL_SIZE = 64 };
 
     EntityList                      entity;
     ParamList                       param;
@@ -229,23 +239,70 @@ public:
         // In general, the tag indicates the subsys that a variable/equation
         // has been assigned to; these are exceptions for variables:
         VAR_SUBSTITUTED      = 10000,
-        VAR_DOF_TEST         = 10001,
         // and for equations:
         EQ_SUBSTITUTED       = 20000
     };
 
+    // The subsystems that share no parameters with each other, and so can
+    // be solved independently; they're tagged firstComponent, ...,
+    // firstComponent + components - 1.
+    int                             firstComponent;
+    int                             components;
+
+    // How many threads may be used to solve those subsystems; with one (or
+    // fewer), they're solved one after another.
+    int                             threads;
+
+    // Whether even the small subsystems are solved with sparse matrices,
+    // to compare against the dense ones.
+    bool                            sparseOnly;
+
+    // How the partial derivatives in the Jacobian are found: by
+    // differentiating each equation symbolically, or numerically, by a
+    // reverse pass over the compiled equations.
+    enum class Differentiation : uint32_t {
+        SYMBOLIC     = 0,
+        REVERSE_MODE = 1
+    };
+    Differentiation                 differentiation;
+
+    // How each Newton step is found: undamped, or with Levenberg-Marquardt
+    // damping, which rejects any step that doesn't reduce the residuals.
+    enum class Method : uint32_t {
+        NEWTON              = 0,
+        LEVENBERG_MARQUARDT = 1
+    };
+    Method                          method;
+
+    // How the last Solve() went: the iterations taken in total, and the
+    // largest residual after each of them, for each subsystem in turn
+    struct {
+        int                 iterations;
+        std::vector<double> residual;
+    } stats;
+
+    // The compiled forms of the Jacobians of earlier solves; see system.cpp
+    struct JacobianForm;
+    class JacobianCache;
+    std::shared_ptr<JacobianCache>  jacobianCache;
+
     // The system Jacobian matrix
     struct {
         // The corresponding equation for each row
         std::vector<Equation *> eq;
 
-        // The corresponding parameter for each column
+        // The corresponding parameter for each column, and where it is
         std::vector<hParam>     param;
+        std::vector<Param *>    paramp;
+        // The values of those parameters while Newton's method is working
+        // on them; they're written back to the params once it's done.
+        Eigen::VectorXd         val;
 
         // We're solving AX = B
         int m, n;
         struct {
-            // This only observes the Expr - does not own them!
+            // This only observes the Expr - does not own them! Like B.sym,
+            // it's only written when the form below gets compiled.
             Eigen::SparseMatrix<Expr *> sym;
             Eigen::SparseMatrix<double> num;
         } A;
@@ -258,26 +315,42 @@ public:
             std::vector<Expr *> sym;
             Eigen::VectorXd     num;
         } B;
+
+        // A.sym and B.sym, compiled so that they're evaluated together
+        std::shared_ptr<JacobianForm> form;
     } mat;
 
     static const double CONVERGE_TOLERANCE;
+    static const double RANK_TOLERANCE;
+    bool IsDense() const;
     int CalculateRank();
     bool TestRank(int *dof = NULL);
-    static bool SolveLinearSystem(const Eigen::SparseMatrix<double> &A,
-                                  const Eigen::VectorXd &B, Eigen::VectorXd *X);
-    bool SolveLeastSquares();
+    bool SolveLeastSquares(double damping = 0.0);
 
-    bool WriteJacobian(int tag);
+    bool WriteJacobian(int tag, bool useCache = false);
+    void WriteJacobianKey(std::vector<uint64_t> *key);
+    void CompileJacobian();
     void EvalJacobian();
+    int ColumnOf(hParam hp) const;
 
     void WriteEquationsExceptFor(hConstraint hc, Group *g);
     void FindWhichToRemoveToFixJacobian(Group *g, List<hConstraint> *bad,
                                         bool forceDofCheck);
     void SolveBySubstitution();
+    void FindComponents(int firstTag);
+    bool IsComponentTag(int tag) const;
+    SolveResult SolveComponent(int tag, Group *g, int *dof);
+    SolveResult SolveComponents(Group *g, int *dof, List<hConstraint> *bad);
+    void SolveComponentsInParallel(Group *g, std::vector<System> *subsystems,
+                                   std::vector<SolveResult> *how, std::vector<int> *dof);
+    void MarkUnsatisfiedConstraints(List<hConstraint> *bad);
 
     bool IsDragged(hParam p);
 
     bool NewtonSolve(int tag);
+    bool NewtonSteps();
+    bool DampedNewtonSteps();
+    double LargestResidual() const;
 
     void MarkParamsFree(bool findFree);
 
@@ -511,6 +584,73 @@ public:
 #undef ENTITY
 #undef CONSTRAINT
 
+// The results of the most recent Booleans between shells (or meshes), by the
+// content hashes of their operands; so that when we regenerate a group whose
+// operands didn't change, we can skip its Boolean.
+template<class T>
+class BooleanCache {
+public:
+    enum { MAX_ENTRIES = 8 };
+    struct Key {
+        uint64_t            hashA;
+        uint64_t            hashB;
+        Group::CombineAs    how;
+        Group::MeshBoolean  meshBoolean;
+        // The result depends on these too, through the pwl curves
+        double              chordTol;
+        int                 maxSegments;
+
+        bool operator==(const Key &k) const {
+            return hashA == k.hashA && hashB == k.hashB && how == k.how &&
+                   meshBoolean == k.meshBoolean &&
+                   EXACT(chordTol == k.chordTol) && maxSegments == k.maxSegments;
+        }
+    };
+    struct Entry {
+        Key     key;
+        T       result;
+    };
+    // Most recently used first
+    std::list<Entry>    entries;
+    unsigned            hits   = 0;
+    unsigned            misses = 0;
+
+    // The stored result, moved to the front; or NULL, if we don't have one
+    T *Find(const Key &key) {
+        for(auto it = entries.begin(); it != entries.end(); ++it) {
+            if(it->key == key) {
+                entries.splice(entries.begin(), entries, it);
+                hits++;
+                return &(entries.front().result);
+            }
+        }
+        misses++;
+        return NULL;
+    }
+    // An empty result to fill in, forgetting the least recently used one if
+    // we're full
+    T *Add(const Key &key) {
+        if(entries.size() >= MAX_ENTRIES) {
+            entries.back().result.Clear();
+            entries.pop_back();
+        }
+        entries.push_front({});
+        entries.front().key = key;
+        return &(entries.front().result);
+    }
+    double HitRate() const {
+        unsigned total = hits + misses;
+        return (total == 0) ? 0.0 : (double)hits / total;
+    }
+    void Clear() {
+        for(Entry &e : entries) {
+            e.result.Clear();
+        }
+        entries.clear();
+        hits = misses = 0;
+    }
+};
+
 class SolveSpaceUI {
 public:
     TextWindow                 *pTW;
@@ -581,6 +721,9 @@ public:
     bool     turntableNav;
     bool     immediatelyEditDimension;
     bool     automaticLineConstraints;
+    bool     solveInParallel;
+    bool     reverseModeJacobian;
+    bool     dampedSolver;
     bool     showToolbar;
     Platform::Path screenshotFile;
     RgbaColor backgroundColor;
@@ -785,6 +928,15 @@ public:
     System     *pSys;
     System     &sys;
 
+    // The results of recent Booleans, for GenerateShellAndMesh()
+    BooleanCache<SShell>    shellBooleans;
+    BooleanCache<SMesh>     meshBooleans;
+    // And the intersection curves between surfaces, for those Booleans that
+    // we do have to redo
+    SIntersectionCache      intersections;
+    // And the triangulations of surfaces, for the meshes of those groups
+    STriangulationCache     triangulations;
+
     // All the TrueType fonts in memory
     TtfFontList fonts;
 
@@ -797,10 +949,13 @@ public:
     bool scheduledShowTW;
     Platform::TimerRef refreshTimer;
     Platform::TimerRef autosaveTimer;
+    Platform::TimerRef refineTimer;
     void Refresh();
+    void RefineDisplay();
     void ScheduleShowTW();
     void ScheduleGenerateAll();
     void ScheduleAutosave();
+    void ScheduleRefineDisplay();
 
     static void MenuHelp(Command id);
 
@@ -825,7 +980,12 @@ bool LinkIDF(const Platform::Path &filename, EntityList *le, SMesh *m, SShell *s
 bool LinkStl(const Platform::Path &filename, EntityList *le, SMesh *m, SShell *sh);
 
 extern SolveSpaceUI SS;
+#ifdef LIBRARY
+// The library can solve on several threads at once, each with its own sketch.
+extern thread_local Sketch SK;
+#else
 extern Sketch SK;
+#endif
 
 }
 
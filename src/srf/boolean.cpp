@@ -39,7 +39,18 @@ static void FindVertsOnCurve(List<SInter> *l, const SCurve *curve, SShell *sh) {
     Vector amax, amin;
     curve->GetAxisAlignedBounding(&amax, &amin);
 
-    for(auto sc : sh->curve) {
+    // The curves whose boxes meet ours, from the hierarchy if there is one
+    std::vector<int> near;
+    if(sh->HasBvhs()) {
+        sh->curveBvh.FindOverlapping(amax, amin, &near);
+    } else {
+        for(int i = 0; i < sh->curve.n; i++) {
+            near.push_back(i);
+        }
+    }
+
+    for(int j : near) {
+        const SCurve &sc = sh->curve[j];
         if(!sc.isExact) continue;
         
         Vector cmax, cmin;
@@ -201,19 +212,20 @@ SCurve SCurve::MakeCopySplitAgainst(SShell *agnstA, SShell *agnstB,
 }
 
 void SShell::CopyCurvesSplitAgainst(bool opA, SShell *agnst, SShell *into) {
+    std::vector<SCurve> scn(curve.n);
 #pragma omp parallel for
     for(int i=0; i<curve.n; i++) {
         SCurve *sc = &curve[i];
-        SCurve scn = sc->MakeCopySplitAgainst(agnst, NULL,
+        scn[i] = sc->MakeCopySplitAgainst(agnst, NULL,
                                 surface.FindById(sc->surfA),
                                 surface.FindById(sc->surfB));
-        scn.source = opA ? SCurve::Source::A : SCurve::Source::B;
-#pragma omp critical
-        {
-            hSCurve hsc = into->curve.AddAndAssignId(&scn);
-            // And note the new ID so that we can rewrite the trims appropriately
-            sc->newH = hsc;
-        }
+        scn[i].source = opA ? SCurve::Source::A : SCurve::Source::B;
+    }
+
+    // Add them in order, so that the new IDs don't depend on the threads.
+    for(int i=0; i<curve.n; i++) {
+        // And note the new ID so that we can rewrite the trims appropriately
+        curve[i].newH = into->curve.AddAndAssignId(&scn[i]);
     }
 }
 
@@ -515,7 +527,7 @@ SSurface SSurface::MakeCopyTrimAgainst(SShell *parent,
     ret.MakeEdgesInto(into, &orig, MakeAs::UV);
     ret.trim.Clear();
     // which means that we can't necessarily use the old BSP...
-    SBspUv *origBsp = SBspUv::From(&orig, &ret);
+    std::shared_ptr<SBspUv> origBsp = SBspUv::From(&orig, &ret);
 
     // And now intersect the other shell against us
     SEdgeList inter = {};
@@ -705,16 +717,148 @@ void SShell::CopySurfacesTrimAgainst(SShell *sha, SShell *shb, SShell *into, SSu
     I += surface.n;
 }
 
+//-----------------------------------------------------------------------------
+// A hash for each surface of everything that its intersections with another
+// surface depend upon: its own shape and trim, and each curve that it shares
+// with a neighbour, and that neighbour's shape. The marching starts where one
+// surface's trim crosses the other, and those points get refined on to the
+// surfaces either side of that trim.
+//-----------------------------------------------------------------------------
+static void MakeIntersectionHashes(SShell *sh, std::vector<uint64_t> *hashes) {
+    std::unordered_map<uint32_t, int> index;
+    std::vector<uint64_t> shape(sh->surface.n);
+    std::vector<ContentHasher> hash(sh->surface.n);
+    for(int i = 0; i < sh->surface.n; i++) {
+        SSurface *s = &(sh->surface[i]);
+        index[s->h.v] = i;
+
+        ContentHasher sp;
+        sp.Add((uint32_t)s->degm);
+        sp.Add((uint32_t)s->degn);
+        for(int j = 0; j <= s->degm; j++) {
+            for(int k = 0; k <= s->degn; k++) {
+                sp.Add(s->ctrl[j][k]);
+                sp.Add(s->weight[j][k]);
+            }
+        }
+        shape[i] = sp.value;
+
+        hash[i].Add(&shape[i], sizeof(shape[i]));
+        hash[i].Add((uint32_t)s->trim.n);
+        for(STrimBy &stb : s->trim) {
+            hash[i].Add((uint32_t)stb.backwards);
+            hash[i].Add(stb.start);
+            hash[i].Add(stb.finish);
+        }
+    }
+
+    for(SCurve &sc : sh->curve) {
+        auto ia = index.find(sc.surfA.v),
+             ib = index.find(sc.surfB.v);
+        if(ia == index.end() || ib == index.end()) continue;
+
+        ContentHasher ch;
+        ch.Add((uint32_t)sc.source);
+        ch.Add((uint32_t)sc.isExact);
+        if(sc.isExact) {
+            ch.Add((uint32_t)sc.exact.deg);
+            for(int i = 0; i <= sc.exact.deg; i++) {
+                ch.Add(sc.exact.ctrl[i]);
+                ch.Add(sc.exact.weight[i]);
+            }
+        }
+        ch.Add((uint32_t)sc.pts.n);
+        for(SCurvePt &pt : sc.pts) {
+            ch.Add(pt.p);
+            ch.Add((uint32_t)pt.vertex);
+        }
+
+        hash[ia->second].Add(&ch.value, sizeof(ch.value));
+        hash[ia->second].Add(&shape[ib->second], sizeof(uint64_t));
+        hash[ib->second].Add(&ch.value, sizeof(ch.value));
+        hash[ib->second].Add(&shape[ia->second], sizeof(uint64_t));
+    }
+
+    hashes->resize(sh->surface.n);
+    for(int i = 0; i < sh->surface.n; i++) {
+        (*hashes)[i] = hash[i].value;
+    }
+}
+
 void SShell::MakeIntersectionCurvesAgainst(SShell *agnst, SShell *into) {
+    agnst->MakeBvhs();
+
+    // Most regenerations change only a few surfaces, so look for the curves
+    // between every pair whose surfaces we've seen before in the cache; it's
+    // only read here, so we can do that in parallel.
+    SIntersectionCache *cache = &SS.intersections;
+    std::vector<uint64_t> hashA, hashB;
+    MakeIntersectionHashes(this, &hashA);
+    MakeIntersectionHashes(agnst, &hashB);
+    SIntersectionCache::Key key = {};
+    key.chordTol    = SS.ChordTolMm();
+    key.maxSegments = SS.GetMaxSegments();
+
+    struct Pair {
+        SIntersectionCache::Key key;
+        bool                    found;
+        // Our curves for this pair, within found[i]
+        size_t                  first, last;
+    };
+    std::vector<std::vector<SNewCurve>> found(surface.n);
+    std::vector<std::vector<Pair>> pairs(surface.n);
 #pragma omp parallel for
     for(int i = 0; i< surface.n; i++) {
         SSurface *sa = &surface[i];
 
-        for(SSurface &sb : agnst->surface){
-            // Intersect every surface from our shell against every surface
-            // from agnst; this will add zero or more curves to the curve
-            // list for into.
-            sa->IntersectAgainst(&sb, this, agnst, into);
+        // Intersect every surface from our shell against every surface
+        // from agnst whose bounding box meets its own; this will find zero
+        // or more curves for into.
+        Vector amax, amin;
+        sa->GetAxisAlignedBounding(&amax, &amin);
+        std::vector<int> near;
+        agnst->surfaceBvh.FindOverlapping(amax, amin, &near);
+        for(int j : near) {
+            SSurface *sb = &(agnst->surface[j]);
+            Pair pr = { key, false, found[i].size(), 0 };
+            pr.key.hashA = hashA[i];
+            pr.key.hashB = hashB[j];
+            const SIntersectionCurves *e = cache->Find(pr.key);
+            if(e != NULL) {
+                e->CopyInto(sa, sb, &found[i]);
+                pr.found = true;
+            } else {
+                sa->IntersectAgainst(sb, this, agnst, &found[i]);
+            }
+            pr.last = found[i].size();
+            pairs[i].push_back(pr);
+        }
+    }
+
+    // Remember what we found for next time, before it's split against the
+    // rest of the two shells.
+    for(int i = 0; i < surface.n; i++) {
+        for(Pair &pr : pairs[i]) {
+            if(pr.found) {
+                cache->MarkUsed(pr.key);
+            } else {
+                cache->Add(pr.key)->MakeFromCopyOf(found[i].data() + pr.first,
+                                                   found[i].data() + pr.last);
+            }
+        }
+    }
+
+#pragma omp parallel for
+    for(int i = 0; i < surface.n; i++) {
+        for(SNewCurve &nc : found[i]) {
+            nc.SplitAgainst(this, agnst);
+        }
+    }
+
+    // And add them in the order that we'd have found them serially.
+    for(std::vector<SNewCurve> &fl : found) {
+        for(SNewCurve &nc : fl) {
+            into->AddIntersectionCurve(&nc);
         }
     }
 }
@@ -794,6 +938,10 @@ void SShell::MakeFromBoolean(SShell *a, SShell *b, SSurface::CombineAs type) {
 
     a->MakeClassifyingBsps(NULL);
     b->MakeClassifyingBsps(NULL);
+    // So that each curve or surface gets tested only against the ones near
+    // it in the other shell
+    a->MakeBvhs();
+    b->MakeBvhs();
 
     // Copy over all the original curves, splitting them so that a
     // piecewise linear segment never crosses a surface from the other
@@ -805,11 +953,13 @@ void SShell::MakeFromBoolean(SShell *a, SShell *b, SSurface::CombineAs type) {
     // the surfaces in B (which is all of the intersection curves).
     a->MakeIntersectionCurvesAgainst(b, this);
 
-    for(SCurve &sc : curve) {
-        SSurface *srfA = sc.GetSurfaceA(a, b),
-                 *srfB = sc.GetSurfaceB(a, b);
+#pragma omp parallel for
+    for(int i = 0; i < curve.n; i++) {
+        SCurve *sc = &curve[i];
+        SSurface *srfA = sc->GetSurfaceA(a, b),
+                 *srfB = sc->GetSurfaceB(a, b);
 
-        sc.RemoveShortSegments(srfA, srfB);
+        sc->RemoveShortSegments(srfA, srfB);
     }
 
     // And clean up the piecewise linear things we made as a calculation aid
@@ -850,21 +1000,36 @@ void SShell::MakeClassifyingBsps(SShell *useCurvesFrom) {
 }
 
 void SSurface::MakeClassifyingBsp(SShell *shell, SShell *useCurvesFrom) {
-    SEdgeList el = {};
+    edges = {};
+    MakeEdgesInto(shell, &edges, MakeAs::XYZ, useCurvesFrom);
 
+    // The BSP is built from these same edges in uv, so if neither they nor
+    // our control points have changed then the one that we have still holds.
+    ContentHasher hash;
+    hash.Add((uint32_t)degm);
+    hash.Add((uint32_t)degn);
+    for(int i = 0; i <= degm; i++) {
+        for(int j = 0; j <= degn; j++) {
+            hash.Add(ctrl[i][j]);
+            hash.Add(weight[i][j]);
+        }
+    }
+    for(const SEdge &se : edges.l) {
+        hash.Add(se.a);
+        hash.Add(se.b);
+        hash.Add((uint32_t)se.auxA);
+        hash.Add((uint32_t)se.auxB);
+    }
+    if(bsp && bspKey == hash.value) return;
+
+    SEdgeList el = {};
     MakeEdgesInto(shell, &el, MakeAs::UV, useCurvesFrom);
     bsp = SBspUv::From(&el, this);
+    bspKey = hash.value;
     el.Clear();
-
-    edges = {};
-    MakeEdgesInto(shell, &edges, MakeAs::XYZ, useCurvesFrom);
-}
-
-SBspUv *SBspUv::Alloc() {
-    return (SBspUv *)AllocTemporary(sizeof(SBspUv));
 }
 
-SBspUv *SBspUv::From(SEdgeList *el, SSurface *srf) {
+std::shared_ptr<SBspUv> SBspUv::From(SEdgeList *el, SSurface *srf) {
     SEdgeList work = {};
 
     SEdge *se;
@@ -877,9 +1042,16 @@ SBspUv *SBspUv::From(SEdgeList *el, SSurface *srf) {
         // stability for the normals.
         return la > lb;
     });
-    SBspUv *bsp = NULL;
+    std::shared_ptr<SBspUv> bsp;
+    if(!work.l.IsEmpty()) {
+        bsp = std::make_shared<SBspUv>();
+        bsp->node.reserve(work.l.n);
+    }
     for(se = work.l.First(); se; se = work.l.NextAfter(se)) {
-        bsp = InsertOrCreateEdge(bsp, (se->a).ProjectXy(), (se->b).ProjectXy(), srf);
+        Point2d ea = (se->a).ProjectXy(),
+                eb = (se->b).ProjectXy();
+        bsp->InsertOrCreateEdge(bsp->node.empty() ? -1 : 0,
+                                ea, ScaleAt(ea, srf), eb, ScaleAt(eb, srf), srf);
     }
 
     work.Clear();
@@ -896,126 +1068,157 @@ SBspUv *SBspUv::From(SEdgeList *el, SSurface *srf) {
 // which is when the linearization is accurate.
 //-----------------------------------------------------------------------------
 
-void SBspUv::ScalePoints(Point2d *pt, Point2d *a, Point2d *b, SSurface *srf) const {
+Point2d SBspUv::ScaleAt(Point2d pt, SSurface *srf) {
     Vector tu, tv;
-    srf->TangentsAt(pt->x, pt->y, &tu, &tv);
-    double mu = tu.Magnitude(), mv = tv.Magnitude();
-
-    pt->x *= mu; pt->y *= mv;
-    a ->x *= mu; a ->y *= mv;
-    b ->x *= mu; b ->y *= mv;
+    srf->TangentsAt(pt.x, pt.y, &tu, &tv);
+    return Point2d::From(tu.Magnitude(), tv.Magnitude());
 }
 
-double SBspUv::ScaledSignedDistanceToLine(Point2d pt, Point2d a, Point2d b,
-                                          SSurface *srf) const
-{
-    ScalePoints(&pt, &a, &b, srf);
+// The scaling s is the one from ScaleAt(pt), computed once per point and
+// not once per node.
+double SBspUv::ScaledSignedDistanceToLine(int i, Point2d pt, Point2d s) const {
+    const Node *f = &node[i];
+    Point2d n = Point2d::From(f->ba.y*s.y, -f->ba.x*s.x);
+    double m = n.Magnitude();
+    // A degenerate edge; measure along u, as WithMagnitude() would.
+    if(m < 1e-20) return (pt.x - f->a.x)*s.x;
 
-    Point2d n = ((b.Minus(a)).Normal()).WithMagnitude(1);
-    double d = a.Dot(n);
-
-    return pt.Dot(n) - d;
+    return ((pt.x - f->a.x)*s.x*n.x + (pt.y - f->a.y)*s.y*n.y) / m;
 }
 
-double SBspUv::ScaledDistanceToLine(Point2d pt, Point2d a, Point2d b, bool asSegment,
-                                    SSurface *srf) const
-{
-    ScalePoints(&pt, &a, &b, srf);
+double SBspUv::ScaledDistanceToLine(int i, Point2d pt, Point2d s, bool asSegment) const {
+    const Node *f = &node[i];
+    Point2d pts = Point2d::From(pt.x*s.x, pt.y*s.y),
+            as  = Point2d::From(f->a.x*s.x, f->a.y*s.y),
+            bas = Point2d::From(f->ba.x*s.x, f->ba.y*s.y);
+
+    return pts.DistanceToLine(as, bas, asSegment);
+}
 
-    return pt.DistanceToLine(a, b, asSegment);
+int SBspUv::AddNode(Point2d a, Point2d b) {
+    Node n = {};
+    n.a    = a;
+    n.b    = b;
+    n.ba   = b.Minus(a);
+    n.pos  = -1;
+    n.neg  = -1;
+    n.more = -1;
+    node.push_back(n);
+    return (int)node.size() - 1;
 }
 
-SBspUv *SBspUv::InsertOrCreateEdge(SBspUv *where, Point2d ea, Point2d eb, SSurface *srf) {
-    if(where == NULL) {
-        SBspUv *ret = Alloc();
-        ret->a = ea;
-        ret->b = eb;
-        return ret;
+int SBspUv::InsertOrCreateEdge(int where, Point2d ea, Point2d sa,
+                               Point2d eb, Point2d sb, SSurface *srf)
+{
+    if(where < 0) {
+        return AddNode(ea, eb);
     }
-    where->InsertEdge(ea, eb, srf);
+    InsertEdge(where, ea, sa, eb, sb, srf);
     return where;
 }
 
-void SBspUv::InsertEdge(Point2d ea, Point2d eb, SSurface *srf) {
-    double dea = ScaledSignedDistanceToLine(ea, a, b, srf),
-           deb = ScaledSignedDistanceToLine(eb, a, b, srf);
+// Note that node may grow as we go, so we hold on to indices and not to
+// references into it.
+void SBspUv::InsertEdge(int i, Point2d ea, Point2d sa,
+                        Point2d eb, Point2d sb, SSurface *srf)
+{
+    double dea = ScaledSignedDistanceToLine(i, ea, sa),
+           deb = ScaledSignedDistanceToLine(i, eb, sb);
 
     if(fabs(dea) < LENGTH_EPS && fabs(deb) < LENGTH_EPS) {
         // Line segment is coincident with this one, store in same node
-        SBspUv *m = Alloc();
-        m->a = ea;
-        m->b = eb;
-        m->more = more;
-        more = m;
+        int m = AddNode(ea, eb);
+        node[m].more = node[i].more;
+        node[i].more = m;
     } else if(fabs(dea) < LENGTH_EPS) {
         // Point A lies on this line, but point B does not
         if(deb > 0) {
-            pos = InsertOrCreateEdge(pos, ea, eb, srf);
+            int r = InsertOrCreateEdge(node[i].pos, ea, sa, eb, sb, srf);
+            node[i].pos = r;
         } else {
-            neg = InsertOrCreateEdge(neg, ea, eb, srf);
+            int r = InsertOrCreateEdge(node[i].neg, ea, sa, eb, sb, srf);
+            node[i].neg = r;
         }
     } else if(fabs(deb) < LENGTH_EPS) {
         // Point B lies on this line, but point A does not
         if(dea > 0) {
-            pos = InsertOrCreateEdge(pos, ea, eb, srf);
+            int r = InsertOrCreateEdge(node[i].pos, ea, sa, eb, sb, srf);
+            node[i].pos = r;
         } else {
-            neg = InsertOrCreateEdge(neg, ea, eb, srf);
+            int r = InsertOrCreateEdge(node[i].neg, ea, sa, eb, sb, srf);
+            node[i].neg = r;
         }
     } else if(dea > 0 && deb > 0) {
-        pos = InsertOrCreateEdge(pos, ea, eb, srf);
+        int r = InsertOrCreateEdge(node[i].pos, ea, sa, eb, sb, srf);
+        node[i].pos = r;
     } else if(dea < 0 && deb < 0) {
-        neg = InsertOrCreateEdge(neg, ea, eb, srf);
+        int r = InsertOrCreateEdge(node[i].neg, ea, sa, eb, sb, srf);
+        node[i].neg = r;
     } else {
         // New edge crosses this one; we need to split.
-        Point2d n = ((b.Minus(a)).Normal()).WithMagnitude(1);
-        double d = a.Dot(n);
+        Point2d n = ((node[i].ba).Normal()).WithMagnitude(1);
+        double d = (node[i].a).Dot(n);
         double t = (d - n.Dot(ea)) / (n.Dot(eb.Minus(ea)));
         Point2d pi = ea.Plus((eb.Minus(ea)).ScaledBy(t));
+        Point2d spi = ScaleAt(pi, srf);
         if(dea > 0) {
-            pos = InsertOrCreateEdge(pos, ea, pi, srf);
-            neg = InsertOrCreateEdge(neg, pi, eb, srf);
+            int r = InsertOrCreateEdge(node[i].pos, ea, sa, pi, spi, srf);
+            node[i].pos = r;
+            r = InsertOrCreateEdge(node[i].neg, pi, spi, eb, sb, srf);
+            node[i].neg = r;
         } else {
-            neg = InsertOrCreateEdge(neg, ea, pi, srf);
-            pos = InsertOrCreateEdge(pos, pi, eb, srf);
+            int r = InsertOrCreateEdge(node[i].neg, ea, sa, pi, spi, srf);
+            node[i].neg = r;
+            r = InsertOrCreateEdge(node[i].pos, pi, spi, eb, sb, srf);
+            node[i].pos = r;
         }
     }
     return;
 }
 
-SBspUv::Class SBspUv::ClassifyPoint(Point2d p, Point2d eb, SSurface *srf) const {
-    double dp = ScaledSignedDistanceToLine(p, a, b, srf);
-
-    if(fabs(dp) < LENGTH_EPS) {
-        const SBspUv *f = this;
-        while(f) {
-            Point2d ba = (f->b).Minus(f->a);
-            if(ScaledDistanceToLine(p, f->a, ba, /*asSegment=*/true, srf) < LENGTH_EPS) {
-                if(ScaledDistanceToLine(eb, f->a, ba, /*asSegment=*/false, srf) < LENGTH_EPS){
-                    if(ba.Dot(eb.Minus(p)) > 0) {
-                        return Class::EDGE_PARALLEL;
+SBspUv::Class SBspUv::ClassifyPoint(int i, Point2d p, Point2d s, Point2d eb,
+                                    SSurface *srf) const
+{
+    for(;;) {
+        const Node *f = &node[i];
+        double dp = ScaledSignedDistanceToLine(i, p, s);
+
+        if(fabs(dp) < LENGTH_EPS) {
+            for(int k = i; k >= 0; k = node[k].more) {
+                if(ScaledDistanceToLine(k, p, s, /*asSegment=*/true) < LENGTH_EPS) {
+                    if(ScaledDistanceToLine(k, eb, ScaleAt(eb, srf),
+                                            /*asSegment=*/false) < LENGTH_EPS) {
+                        if((node[k].ba).Dot(eb.Minus(p)) > 0) {
+                            return Class::EDGE_PARALLEL;
+                        } else {
+                            return Class::EDGE_ANTIPARALLEL;
+                        }
                     } else {
-                        return Class::EDGE_ANTIPARALLEL;
+                        return Class::EDGE_OTHER;
                     }
-                } else {
-                    return Class::EDGE_OTHER;
                 }
             }
-            f = f->more;
-        }
-        // Pick arbitrarily which side to send it down, doesn't matter
-        Class c1 =  neg ? neg->ClassifyPoint(p, eb, srf) : Class::OUTSIDE;
-        Class c2 =  pos ? pos->ClassifyPoint(p, eb, srf) : Class::INSIDE;
-        if(c1 != c2) {
-            dbp("MISMATCH: %d %d %08x %08x", c1, c2, neg, pos);
+            // Pick arbitrarily which side to send it down, doesn't matter
+            Class c1 = (f->neg >= 0) ? ClassifyPoint(f->neg, p, s, eb, srf) : Class::OUTSIDE;
+            Class c2 = (f->pos >= 0) ? ClassifyPoint(f->pos, p, s, eb, srf) : Class::INSIDE;
+            if(c1 != c2) {
+                dbp("MISMATCH: %d %d %d %d", c1, c2, f->neg, f->pos);
+            }
+            return c1;
+        } else if(dp > 0) {
+            if(f->pos < 0) return Class::INSIDE;
+            i = f->pos;
+        } else {
+            if(f->neg < 0) return Class::OUTSIDE;
+            i = f->neg;
         }
-        return c1;
-    } else if(dp > 0) {
-        return pos ? pos->ClassifyPoint(p, eb, srf) : Class::INSIDE;
-    } else {
-        return neg ? neg->ClassifyPoint(p, eb, srf) : Class::OUTSIDE;
     }
 }
 
+SBspUv::Class SBspUv::ClassifyPoint(Point2d p, Point2d eb, SSurface *srf) const {
+    return ClassifyPoint(0, p, ScaleAt(p, srf), eb, srf);
+}
+
 SBspUv::Class SBspUv::ClassifyEdge(Point2d ea, Point2d eb, SSurface *srf) const {
     SBspUv::Class ret = ClassifyPoint((ea.Plus(eb)).ScaledBy(0.5), eb, srf);
     if(ret == Class::EDGE_OTHER) {
@@ -1027,15 +1230,17 @@ SBspUv::Class SBspUv::ClassifyEdge(Point2d ea, Point2d eb, SSurface *srf) const
     return ret;
 }
 
-double SBspUv::MinimumDistanceToEdge(Point2d p, SSurface *srf) const {
+double SBspUv::MinimumDistanceToEdge(int i, Point2d p, Point2d s) const {
+    const Node *f = &node[i];
 
-    double dn = (neg) ? neg->MinimumDistanceToEdge(p, srf) : VERY_POSITIVE;
-    double dp = (pos) ? pos->MinimumDistanceToEdge(p, srf) : VERY_POSITIVE;
+    double dn = (f->neg >= 0) ? MinimumDistanceToEdge(f->neg, p, s) : VERY_POSITIVE;
+    double dp = (f->pos >= 0) ? MinimumDistanceToEdge(f->pos, p, s) : VERY_POSITIVE;
 
-    Point2d as = a, bs = b;
-    ScalePoints(&p, &as, &bs, srf);
-    double d = p.DistanceToLine(as, bs.Minus(as), /*asSegment=*/true);
+    double d = ScaledDistanceToLine(i, p, s, /*asSegment=*/true);
 
     return min(d, min(dn, dp));
 }
 
+double SBspUv::MinimumDistanceToEdge(Point2d p, SSurface *srf) const {
+    return MinimumDistanceToEdge(0, p, ScaleAt(p, srf));
+}
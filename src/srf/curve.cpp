@@ -118,6 +118,77 @@ bool SBezier::IsInPlane(Vector n, double d) const {
     return true;
 }
 
+//-----------------------------------------------------------------------------
+// Find the parameters at which this Bezier crosses the plane n dot p = d.
+// The distance times the weight is a polynomial of our degree, so we break
+// it into monotonic pieces at the roots of its derivative, and bisect each
+// piece that changes sign. If the curve touches the plane tangentially, or
+// has an endpoint in it, then there's no clean answer, so return false.
+//-----------------------------------------------------------------------------
+bool SBezier::PlaneCrossings(Vector n, double d, List<double> *lt) const {
+    double b[4], a[4] = {};
+    int i, k;
+    for(i = 0; i <= deg; i++) {
+        b[i] = weight[i]*((ctrl[i]).Dot(n) - d);
+    }
+    if(fabs(b[0]) < LENGTH_EPS || fabs(b[deg]) < LENGTH_EPS) return false;
+
+    // Convert from the Bernstein to the power basis, by forward differences.
+    static const double binomial[4][4] = {
+        { 1, 0, 0, 0 }, { 1, 1, 0, 0 }, { 1, 2, 1, 0 }, { 1, 3, 3, 1 } };
+    for(k = 0; k <= deg; k++) {
+        a[k] = binomial[deg][k]*b[0];
+        for(i = 0; i < deg - k; i++) {
+            b[i] = b[i+1] - b[i];
+        }
+    }
+    auto g = [&](double t) {
+        return ((a[3]*t + a[2])*t + a[1])*t + a[0];
+    };
+
+    // The derivative is 3*a[3]*t^2 + 2*a[2]*t + a[1].
+    double c2 = 3*a[3], c1 = 2*a[2], c0 = a[1];
+    double tb[4];
+    int tbn = 0;
+    tb[tbn++] = 0;
+    if(fabs(c2) > 1e-14*(fabs(c1) + fabs(c0))) {
+        double disc = c1*c1 - 4*c2*c0;
+        if(disc >= 0) {
+            double sq = sqrt(disc),
+                   t0 = (-c1 - sq)/(2*c2),
+                   t1 = (-c1 + sq)/(2*c2);
+            if(t0 > t1) swap(t0, t1);
+            if(t0 > 0 && t0 < 1) tb[tbn++] = t0;
+            if(t1 > 0 && t1 < 1 && t1 != t0) tb[tbn++] = t1;
+        }
+    } else if(fabs(c1) > 1e-20) {
+        double t0 = -c0/c1;
+        if(t0 > 0 && t0 < 1) tb[tbn++] = t0;
+    }
+    tb[tbn++] = 1;
+
+    for(i = 1; i < tbn - 1; i++) {
+        if(fabs(g(tb[i])) < LENGTH_EPS) return false;
+    }
+    for(i = 0; i < tbn - 1; i++) {
+        double ta = tb[i], tf = tb[i+1],
+               ga = g(ta),  gf = g(tf);
+        if((ga > 0) == (gf > 0)) continue;
+        for(k = 0; k < 60 && (tf - ta) > 1e-15; k++) {
+            double tm = (ta + tf)/2, gm = g(tm);
+            if((gm > 0) == (ga > 0)) {
+                ta = tm;
+                ga = gm;
+            } else {
+                tf = tm;
+            }
+        }
+        double t = (ta + tf)/2;
+        lt->Add(&t);
+    }
+    return true;
+}
+
 //-----------------------------------------------------------------------------
 // Is this Bezier exactly the arc of a circle, projected along the specified
 // axis? If yes, return that circle's center and radius.
@@ -6,12 +6,97 @@
 //-----------------------------------------------------------------------------
 #include "../solvespace.h"
 
+//-----------------------------------------------------------------------------
+// To avoid testing every pair of surfaces, the candidates get bucketed by
+// their color and their plane, with each component of the unit normal
+// quantized to NORMAL_CELL and the offset from the origin to OFFSET_CELL. A
+// surface that lies within LENGTH_EPS of another one's plane then falls in
+// the same or in an adjacent cell, unless it's so narrow (or so far from the
+// origin) that its own plane is poorly determined; those surfaces are tested
+// against everything.
+//-----------------------------------------------------------------------------
+static const double NORMAL_CELL = 1e-3;
+static const double OFFSET_CELL = 1e-2;
+
+struct PlaneCell {
+    int64_t     n[3];
+    int64_t     d;
+    uint32_t    color;
+
+    bool operator==(const PlaneCell &o) const {
+        return n[0] == o.n[0] && n[1] == o.n[1] && n[2] == o.n[2] &&
+               d == o.d && color == o.color;
+    }
+};
+
+struct PlaneCellHash {
+    size_t operator()(const PlaneCell &c) const {
+        ContentHasher h;
+        h.Add(c.n, sizeof(c.n));
+        h.Add(&c.d, sizeof(c.d));
+        h.Add(c.color);
+        return (size_t)h.value;
+    }
+};
+
+static PlaneCell PlaneCellFor(const SSurface *s) {
+    Vector n = s->NormalAt(0, 0).WithMagnitude(1);
+    double d = n.Dot(s->ctrl[0][0]);
+
+    PlaneCell c;
+    c.n[0]  = (int64_t)floor(n.x / NORMAL_CELL);
+    c.n[1]  = (int64_t)floor(n.y / NORMAL_CELL);
+    c.n[2]  = (int64_t)floor(n.z / NORMAL_CELL);
+    c.d     = (int64_t)floor(d / OFFSET_CELL);
+    c.color = s->color.ToPackedInt();
+    return c;
+}
+
+static bool IsPlaneWellDetermined(const SSurface *s) {
+    // The normal comes from the control points at (0, 0), (1, 0) and (0, 1).
+    // If each of those moves by LENGTH_EPS normal to the plane, then the
+    // normal tilts by up to 2*LENGTH_EPS over the shortest altitude of that
+    // triangle, and the offset by that tilt times the distance from origin.
+    Vector p  = s->ctrl[0][0],
+           e1 = (s->ctrl[1][0]).Minus(p),
+           e2 = (s->ctrl[0][1]).Minus(p);
+    double longest = max(e1.Magnitude(), max(e2.Magnitude(), (e1.Minus(e2)).Magnitude()));
+    double altitude = (e1.Cross(e2)).Magnitude() / longest;
+    double tilt = 2*LENGTH_EPS / altitude;
+    // Written so that a degenerate triangle (with a NaN tilt) fails too.
+    return (2*tilt < NORMAL_CELL) &&
+           (2*(tilt*p.Magnitude() + LENGTH_EPS) < OFFSET_CELL);
+}
+
 void SShell::MergeCoincidentSurfaces() {
     surface.ClearTags();
 
-    int i, j;
+    int i;
     SSurface *si, *sj;
 
+    // Only planes with trims can merge, so those are the candidates.
+    std::unordered_map<PlaneCell, std::vector<int>, PlaneCellHash> buckets;
+    std::vector<int> candidates, loose;
+    std::vector<bool> isLoose(surface.n, false);
+    std::vector<PlaneCell> cells(surface.n);
+    for(i = 0; i < surface.n; i++) {
+        si = &(surface[i]);
+        if(si->trim.IsEmpty()) continue;
+        if(si->degm != 1 || si->degn != 1) continue;
+
+        candidates.push_back(i);
+        cells[i] = PlaneCellFor(si);
+        if(IsPlaneWellDetermined(si)) {
+            buckets[cells[i]].push_back(i);
+        } else {
+            loose.push_back(i);
+            isLoose[i] = true;
+        }
+    }
+    // A candidate's edges don't change until it's merged, so we generate
+    // them only once, when first needed.
+    std::vector<SEdgeList> edges(surface.n);
+
     for(i = 0; i < surface.n; i++) {
         si = &(surface[i]);
         if(si->tag) continue;
@@ -23,6 +108,34 @@ void SShell::MergeCoincidentSurfaces() {
         // time on other surfaces.
         if(si->degm != 1 || si->degn != 1) continue;
 
+        // Gather everything after us that might be coincident, in the same
+        // order as in the shell, so that we merge in the same order too. If
+        // our own plane is poorly determined, then our cell says nothing
+        // about where the coincident surfaces are, so that's every candidate.
+        std::vector<int> near;
+        if(isLoose[i]) {
+            for(int b : candidates) {
+                if(b > i) near.push_back(b);
+            }
+        } else {
+            for(int k = 0; k < 81; k++) {
+                PlaneCell c = cells[i];
+                c.n[0] += (k % 3) - 1;
+                c.n[1] += (k / 3 % 3) - 1;
+                c.n[2] += (k / 9 % 3) - 1;
+                c.d    += (k / 27) - 1;
+                auto it = buckets.find(c);
+                if(it == buckets.end()) continue;
+                for(int b : it->second) {
+                    if(b > i) near.push_back(b);
+                }
+            }
+            for(int b : loose) {
+                if(b > i) near.push_back(b);
+            }
+            std::sort(near.begin(), near.end());
+        }
+
         SEdgeList sel = {};
         si->MakeEdgesInto(this, &sel, SSurface::MakeAs::XYZ);
 
@@ -30,7 +143,7 @@ void SShell::MergeCoincidentSurfaces() {
         do {
             mergedThisTime = false;
 
-            for(j = i + 1; j < surface.n; j++) {
+            for(int j : near) {
                 sj = &(surface[j]);
                 if(sj->tag) continue;
                 if(!sj->CoincidentWith(si, /*sameNormal=*/true)) continue;
@@ -42,18 +155,19 @@ void SShell::MergeCoincidentSurfaces() {
                 // surfaces if they contain disjoint contours; that just makes
                 // the bounding box tests less effective, and possibly things
                 // less robust.
-                SEdgeList tel = {};
-                sj->MakeEdgesInto(this, &tel, SSurface::MakeAs::XYZ);
-                if(!sel.ContainsEdgeFrom(&tel)) {
-                    tel.Clear();
-                    continue;
+                SEdgeList *tel = &edges[j];
+                if(tel->l.IsEmpty()) {
+                    sj->MakeEdgesInto(this, tel, SSurface::MakeAs::XYZ);
                 }
-                tel.Clear();
+                if(!sel.ContainsEdgeFrom(tel)) continue;
 
                 sj->tag = 1;
                 merged = true;
                 mergedThisTime = true;
-                sj->MakeEdgesInto(this, &sel, SSurface::MakeAs::XYZ);
+                for(const SEdge &se : tel->l) {
+                    sel.l.Add(&se);
+                }
+                tel->Clear();
                 sj->trim.Clear();
 
                 // All the references to this surface get replaced with the
@@ -122,6 +236,12 @@ void SShell::MergeCoincidentSurfaces() {
         sel.Clear();
     }
 
+    for(SEdgeList &tel : edges) {
+        tel.Clear();
+    }
+
     surface.RemoveTagged();
+    // The merged surfaces got new bounding boxes.
+    ClearBvhs();
 }
 
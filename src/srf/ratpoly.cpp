@@ -50,6 +50,40 @@ Vector SBezier::PointAt(double t) const {
     return pt;
 }
 
+// The batch evaluators below work through their inputs in blocks of this
+// many points, keeping per-point sums in separate arrays (structure of arrays)
+// so that the inner loops run over independent points and vectorize.
+static const int EVAL_BATCH = 16;
+
+// Evaluate the curve at n parameter values. The arithmetic is ordered as in
+// PointAt(), so the results are bit-identical to calling that n times.
+void SBezier::PointsAt(const double *t, int n, Vector *pt) const {
+    double x[EVAL_BATCH], y[EVAL_BATCH], z[EVAL_BATCH], d[EVAL_BATCH];
+    int s, i, k;
+    for(s = 0; s < n; s += EVAL_BATCH) {
+        int m = min(EVAL_BATCH, n - s);
+        for(k = 0; k < m; k++) {
+            x[k] = y[k] = z[k] = d[k] = 0;
+        }
+        for(i = 0; i <= deg; i++) {
+            Vector c = ctrl[i];
+            double w = weight[i];
+            for(k = 0; k < m; k++) {
+                double B = Bernstein(i, deg, t[s+k]),
+                       f = B*w;
+                x[k] += c.x*f;
+                y[k] += c.y*f;
+                z[k] += c.z*f;
+                d[k] += w*B;
+            }
+        }
+        for(k = 0; k < m; k++) {
+            double r = 1.0/d[k];
+            pt[s+k] = Vector::From(x[k]*r, y[k]*r, z[k]*r);
+        }
+    }
+}
+
 Vector SBezier::TangentAt(double t) const {
     Vector pt = Vector::From(0, 0, 0), pt_p = Vector::From(0, 0, 0);
     double d = 0, d_p = 0;
@@ -78,13 +112,16 @@ void SBezier::ClosestPointTo(Vector p, double *t, bool mustConverge) const {
     double minDist = VERY_POSITIVE;
     *t = 0;
     double res = (deg <= 2) ? 7.0 : 20.0;
+    double tryt[20];
+    Vector tryp[20];
     for(i = 0; i < (int)res; i++) {
-        double tryt = (i/res);
-
-        Vector tryp = PointAt(tryt);
-        double d = (tryp.Minus(p)).Magnitude();
+        tryt[i] = (i/res);
+    }
+    PointsAt(tryt, (int)res, tryp);
+    for(i = 0; i < (int)res; i++) {
+        double d = (tryp[i].Minus(p)).Magnitude();
         if(d < minDist) {
-            *t = tryt;
+            *t = tryt[i];
             minDist = d;
         }
     }
@@ -228,10 +265,10 @@ void SBezier::MakePwlInto(List<Vector> *l, double chordTol, double max_dt) const
 }
 void SBezier::MakePwlWorker(List<Vector> *l, double ta, double tb, double chordTol, double max_dt) const
 {
-    Vector pa = PointAt(ta);
-    Vector pb = PointAt(tb);
-
-    Vector pm = PointAt((ta + tb) / 2.0);
+    double t[3] = { ta, tb, (ta + tb) / 2.0 };
+    Vector p[3];
+    PointsAt(t, 3, p);
+    Vector pa = p[0], pb = p[1], pm = p[2];
     double d = pm.DistanceToLine(pa, pb.Minus(pa));
 
     double step = 1.0/SS.GetMaxSegments();
@@ -246,16 +283,13 @@ void SBezier::MakePwlWorker(List<Vector> *l, double ta, double tb, double chordT
 }
 void SBezier::MakePwlInitialWorker(List<Vector> *l, double ta, double tb, double chordTol, double max_dt) const
 {
-    Vector pa = PointAt(ta);
-    Vector pb = PointAt(tb);
-
-    double tm1 = ta + (tb - ta) * 0.25;
-    double tm2 = ta + (tb - ta) * 0.5;
-    double tm3 = ta + (tb - ta) * 0.75;
-
-    Vector pm1 = PointAt(tm1);
-    Vector pm2 = PointAt(tm2);
-    Vector pm3 = PointAt(tm3);
+    double t[5] = { ta, tb,
+                    ta + (tb - ta) * 0.25,
+                    ta + (tb - ta) * 0.5,
+                    ta + (tb - ta) * 0.75 };
+    Vector p[5];
+    PointsAt(t, 5, p);
+    Vector pa = p[0], pb = p[1], pm1 = p[2], pm2 = p[3], pm3 = p[4];
     Vector dir = pb.Minus(pa);
 
     double d = max({
@@ -307,6 +341,31 @@ void SBezier::MakeNonrationalCubicInto(SBezierList *bl, double tolerance, int de
     }
 }
 
+//-----------------------------------------------------------------------------
+// The curve along which u (if constU) or v is held constant at t. That's a
+// rational Bezier in the other parameter, so this is exact.
+//-----------------------------------------------------------------------------
+SBezier SSurface::IsoparametricCurve(bool constU, double t) const {
+    SBezier sb = {};
+    sb.deg = constU ? degn : degm;
+
+    int i, j;
+    for(j = 0; j <= sb.deg; j++) {
+        Vector p = Vector::From(0, 0, 0);
+        double w = 0;
+        for(i = 0; i <= (constU ? degm : degn); i++) {
+            double cw = constU ? weight[i][j] : weight[j][i];
+            Vector c  = constU ? ctrl[i][j]   : ctrl[j][i];
+            double B  = Bernstein(i, constU ? degm : degn, t)*cw;
+            p = p.Plus(c.ScaledBy(B));
+            w += B;
+        }
+        sb.ctrl[j] = p.ScaledBy(1.0/w);
+        sb.weight[j] = w;
+    }
+    return sb;
+}
+
 Vector SSurface::PointAt(Point2d puv) const {
     return PointAt(puv.x, puv.y);
 }
@@ -328,6 +387,44 @@ Vector SSurface::PointAt(double u, double v) const {
     return num;
 }
 
+// Evaluate the surface at the n points (u[k], v[k]); bit-identical to n calls
+// to PointAt(). The basis functions are tabulated once per block, instead of
+// once per control point as in the scalar version.
+void SSurface::PointsAt(const double *u, const double *v, int n, Vector *pt) const {
+    double bu[4][EVAL_BATCH], bv[4][EVAL_BATCH];
+    double x[EVAL_BATCH], y[EVAL_BATCH], z[EVAL_BATCH], d[EVAL_BATCH];
+    int s, i, j, k;
+    for(s = 0; s < n; s += EVAL_BATCH) {
+        int m = min(EVAL_BATCH, n - s);
+        for(i = 0; i <= degm; i++) {
+            for(k = 0; k < m; k++) bu[i][k] = Bernstein(i, degm, u[s+k]);
+        }
+        for(j = 0; j <= degn; j++) {
+            for(k = 0; k < m; k++) bv[j][k] = Bernstein(j, degn, v[s+k]);
+        }
+        for(k = 0; k < m; k++) {
+            x[k] = y[k] = z[k] = d[k] = 0;
+        }
+        for(i = 0; i <= degm; i++) {
+            for(j = 0; j <= degn; j++) {
+                Vector c = ctrl[i][j];
+                double w = weight[i][j];
+                for(k = 0; k < m; k++) {
+                    double f = bu[i][k]*bv[j][k]*w;
+                    x[k] += c.x*f;
+                    y[k] += c.y*f;
+                    z[k] += c.z*f;
+                    d[k] += w*bu[i][k]*bv[j][k];
+                }
+            }
+        }
+        for(k = 0; k < m; k++) {
+            double r = 1.0/d[k];
+            pt[s+k] = Vector::From(x[k]*r, y[k]*r, z[k]*r);
+        }
+    }
+}
+
 void SSurface::TangentsAt(double u, double v, Vector *tu, Vector *tv, bool retry) const {
     Vector num   = Vector::From(0, 0, 0),
            num_u = Vector::From(0, 0, 0),
@@ -378,6 +475,74 @@ Vector SSurface::NormalAt(double u, double v) const {
     return tu.Cross(tv);
 }
 
+// Unnormalized normals at the n points (u[k], v[k]), bit-identical to n calls
+// to NormalAt(). Points where a tangent vanishes (the poles of a sphere, say)
+// go through TangentsAt() for its nudge-and-retry.
+void SSurface::NormalsAt(const double *u, const double *v, int n, Vector *nrm) const {
+    double bu[4][EVAL_BATCH], bv[4][EVAL_BATCH], bup[4][EVAL_BATCH], bvp[4][EVAL_BATCH];
+    double x[EVAL_BATCH],  y[EVAL_BATCH],  z[EVAL_BATCH],  d[EVAL_BATCH],
+           xu[EVAL_BATCH], yu[EVAL_BATCH], zu[EVAL_BATCH], du[EVAL_BATCH],
+           xv[EVAL_BATCH], yv[EVAL_BATCH], zv[EVAL_BATCH], dv[EVAL_BATCH];
+    int s, i, j, k;
+    for(s = 0; s < n; s += EVAL_BATCH) {
+        int m = min(EVAL_BATCH, n - s);
+        for(i = 0; i <= degm; i++) {
+            for(k = 0; k < m; k++) {
+                bu[i][k]  = Bernstein(i, degm, u[s+k]);
+                bup[i][k] = BernsteinDerivative(i, degm, u[s+k]);
+            }
+        }
+        for(j = 0; j <= degn; j++) {
+            for(k = 0; k < m; k++) {
+                bv[j][k]  = Bernstein(j, degn, v[s+k]);
+                bvp[j][k] = BernsteinDerivative(j, degn, v[s+k]);
+            }
+        }
+        for(k = 0; k < m; k++) {
+            x[k]  = y[k]  = z[k]  = d[k]  = 0;
+            xu[k] = yu[k] = zu[k] = du[k] = 0;
+            xv[k] = yv[k] = zv[k] = dv[k] = 0;
+        }
+        for(i = 0; i <= degm; i++) {
+            for(j = 0; j <= degn; j++) {
+                Vector c = ctrl[i][j];
+                double w = weight[i][j];
+                for(k = 0; k < m; k++) {
+                    double f  = bu[i][k]*bv[j][k]*w,
+                           fu = bup[i][k]*bv[j][k]*w,
+                           fv = bu[i][k]*bvp[j][k]*w;
+                    x[k]  += c.x*f;
+                    y[k]  += c.y*f;
+                    z[k]  += c.z*f;
+                    d[k]  += w*bu[i][k]*bv[j][k];
+                    xu[k] += c.x*fu;
+                    yu[k] += c.y*fu;
+                    zu[k] += c.z*fu;
+                    du[k] += w*bup[i][k]*bv[j][k];
+                    xv[k] += c.x*fv;
+                    yv[k] += c.y*fv;
+                    zv[k] += c.z*fv;
+                    dv[k] += w*bu[i][k]*bvp[j][k];
+                }
+            }
+        }
+        for(k = 0; k < m; k++) {
+            // quotient rule, as in TangentsAt()
+            double r = 1.0/(d[k]*d[k]);
+            Vector tu = Vector::From((xu[k]*d[k] - x[k]*du[k])*r,
+                                     (yu[k]*d[k] - y[k]*du[k])*r,
+                                     (zu[k]*d[k] - z[k]*du[k])*r),
+                   tv = Vector::From((xv[k]*d[k] - x[k]*dv[k])*r,
+                                     (yv[k]*d[k] - y[k]*dv[k])*r,
+                                     (zv[k]*d[k] - z[k]*dv[k])*r);
+            if(tu.Equals(Vector::From(0, 0, 0)) || tv.Equals(Vector::From(0, 0, 0))) {
+                TangentsAt(u[s+k], v[s+k], &tu, &tv);
+            }
+            nrm[s+k] = tu.Cross(tv);
+        }
+    }
+}
+
 void SSurface::ClosestPointTo(Vector p, Point2d *puv, bool mustConverge) {
     ClosestPointTo(p, &(puv->x), &(puv->y), mustConverge);
 }
@@ -423,21 +588,26 @@ void SSurface::ClosestPointTo(Vector p, double *u, double *v, bool mustConverge)
         }
     }
 
-    // Search for a reasonable initial guess
+    // Search for a reasonable initial guess, evaluating the whole grid in
+    // one batch.
     int i, j;
     double minDist = VERY_POSITIVE;
     int res = (max(degm, degn) == 2) ? 7 : 20;
+    double tryu[20*20], tryv[20*20];
+    Vector tryp[20*20];
     for(i = 0; i < res; i++) {
         for(j = 0; j < res; j++) {
-            double tryu = (i + 0.5)/res, tryv = (j + 0.5)/res;
-
-            Vector tryp = PointAt(tryu, tryv);
-            double d = (tryp.Minus(p)).Magnitude();
-            if(d < minDist) {
-                *u = tryu;
-                *v = tryv;
-                minDist = d;
-            }
+            tryu[i*res + j] = (i + 0.5)/res;
+            tryv[i*res + j] = (j + 0.5)/res;
+        }
+    }
+    PointsAt(tryu, tryv, res*res, tryp);
+    for(i = 0; i < res*res; i++) {
+        double d = (tryp[i].Minus(p)).Magnitude();
+        if(d < minDist) {
+            *u = tryu[i];
+            *v = tryv[i];
+            minDist = d;
         }
     }
 
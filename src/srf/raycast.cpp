@@ -235,6 +235,97 @@ void SSurface::AllPointsIntersectingUntrimmed(Vector a, Vector b,
     surf1.AllPointsIntersectingUntrimmed(a, b, cnt, level, l, asSegment, sorig);
 }
 
+//-----------------------------------------------------------------------------
+// Split a surface in the same way that AllPointsIntersectingUntrimmed() would,
+// all the way down to the pieces where it would switch to Newton's method,
+// and remember their bounding boxes. If that takes too many pieces, then we
+// give up and leave the tree empty, so that it won't get used.
+//-----------------------------------------------------------------------------
+void SPatchTree::Build(SSurface *srf) {
+    Clear();
+    chordTol = SS.ChordTolMm();
+    if(!BuildNode(srf, 0)) {
+        Clear();
+    }
+}
+
+bool SPatchTree::BuildNode(SSurface *srf, int level) {
+    if((int)node.size() >= MAX_NODES || level > MAX_DEPTH) return false;
+
+    int i = (int)node.size();
+    Node n = {};
+    srf->GetAxisAlignedBounding(&n.max, &n.min);
+    n.right = -1;
+    if(srf->DepartureFromCoplanar() < 0.2*chordTol) {
+        int degm = srf->degm, degn = srf->degn;
+        n.p = (srf->ctrl[0   ][0   ]).Plus(
+               srf->ctrl[0   ][degn]).Plus(
+               srf->ctrl[degm][0   ]).Plus(
+               srf->ctrl[degm][degn]).ScaledBy(0.25);
+        node.push_back(n);
+        return true;
+    }
+    node.push_back(n);
+
+    SSurface surf0, surf1;
+    srf->SplitInHalf((level & 1) == 0, &surf0, &surf1);
+    if(!BuildNode(&surf0, level + 1)) return false;
+    node[i].right = (int)node.size();
+    return BuildNode(&surf1, level + 1);
+}
+
+bool SPatchTree::IsUsable() const {
+    return !node.empty() && EXACT(chordTol == SS.ChordTolMm());
+}
+
+//-----------------------------------------------------------------------------
+// The same as AllPointsIntersectingUntrimmed() on the surface that we were
+// built from, visiting the same pieces in the same order, so that we find the
+// same points; but without splitting anything.
+//-----------------------------------------------------------------------------
+void SPatchTree::AllPointsIntersecting(Vector a, Vector b,
+                                       List<SSurface::Inter> *l,
+                                       bool asSegment, SSurface *sorig) const
+{
+    int cnt = 0;
+    std::vector<int> stack;
+    stack.push_back(0);
+    while(!stack.empty()) {
+        int i = stack.back();
+        stack.pop_back();
+        const Node &n = node[i];
+
+        if(!Vector::BoundingBoxIntersectsLine(n.max, n.min, a, b, asSegment) &&
+           a.OutsideAndNotOn(n.max, n.min) && b.OutsideAndNotOn(n.max, n.min))
+        {
+            continue;
+        }
+
+        if(cnt > 2000) {
+            dbp("!!! too many subdivisions!");
+            return;
+        }
+        cnt++;
+
+        if(n.right < 0) {
+            SSurface::Inter inter;
+            sorig->ClosestPointTo(n.p, &(inter.p.x), &(inter.p.y),
+                                  /*mustConverge=*/false);
+            if(sorig->PointIntersectingLine(a, b, &(inter.p.x), &(inter.p.y))) {
+                l->Add(&inter);
+            }
+            continue;
+        }
+
+        stack.push_back(n.right);
+        stack.push_back(i + 1);
+    }
+}
+
+void SPatchTree::Clear() {
+    node.clear();
+}
+
 //-----------------------------------------------------------------------------
 // Find all points where a line through a and b intersects our surface, and
 // add them to the list. If seg is true then report only intersections that
@@ -245,7 +336,8 @@ void SSurface::AllPointsIntersectingUntrimmed(Vector a, Vector b,
 //-----------------------------------------------------------------------------
 void SSurface::AllPointsIntersecting(Vector a, Vector b,
                                      List<SInter> *l,
-                                     bool asSegment, bool trimmed, bool inclTangent)
+                                     bool asSegment, bool trimmed, bool inclTangent,
+                                     const SPatchTree *patches)
 {
     if(LineEntirelyOutsideBbox(a, b, asSegment)) return;
 
@@ -330,9 +422,14 @@ void SSurface::AllPointsIntersecting(Vector a, Vector b,
             inters.Add(&inter);
         }
     } else {
-        // General numerical solution by subdivision, fallback
-        int cnt = 0, level = 0;
-        AllPointsIntersectingUntrimmed(a, b, &cnt, &level, &inters, asSegment, this);
+        // General numerical solution by subdivision, fallback; already
+        // subdivided, if our shell made the pieces for us.
+        if(patches != NULL && patches->IsUsable()) {
+            patches->AllPointsIntersecting(a, b, &inters, asSegment, this);
+        } else {
+            int cnt = 0, level = 0;
+            AllPointsIntersectingUntrimmed(a, b, &cnt, &level, &inters, asSegment, this);
+        }
     }
 
     // Remove duplicate intersection points
@@ -381,6 +478,17 @@ void SShell::AllPointsIntersecting(Vector a, Vector b,
                                    List<SInter> *il,
                                    bool asSegment, bool trimmed, bool inclTangent)
 {
+    if(HasBvhs()) {
+        // Only the surfaces whose boxes the line comes near, but still in
+        // the same order.
+        std::vector<int> near;
+        surfaceBvh.FindNearLine(a, b, asSegment, &near);
+        for(int i : near) {
+            surface[i].AllPointsIntersecting(a, b, il,
+                asSegment, trimmed, inclTangent, PatchesAt(i));
+        }
+        return;
+    }
     for(SSurface &ss : surface) {
         ss.AllPointsIntersecting(a, b, il,
             asSegment, trimmed, inclTangent);
@@ -430,10 +538,22 @@ bool SShell::ClassifyEdge(Class *indir, Class *outdir,
 {
     List<SInter> l = {};
 
+    // Only the surfaces whose boxes the edge comes near can matter below, and
+    // if we have the hierarchy then we can find those quickly.
+    std::vector<int> near;
+    if(HasBvhs()) {
+        surfaceBvh.FindNearLine(ea, eb, /*asSegment=*/true, &near);
+    } else {
+        for(int i = 0; i < surface.n; i++) {
+            near.push_back(i);
+        }
+    }
+
     // First, check for edge-on-edge
     int edge_inters = 0;
     Vector inter_surf_n[2], inter_edge_n[2];
-    for(SSurface &srf : surface) {
+    for(int i : near) {
+        SSurface &srf = surface[i];
         if(srf.LineEntirelyOutsideBbox(ea, eb, /*asSegment=*/true)) continue;
 
         SEdgeList *sel = &(srf.edges);
@@ -518,7 +638,8 @@ bool SShell::ClassifyEdge(Class *indir, Class *outdir,
     // are on surface) and for numerical stability, so we don't pick up
     // the additional error from the line intersection.
 
-    for(SSurface &srf : surface) {
+    for(int i : near) {
+        SSurface &srf = surface[i];
         if(srf.LineEntirelyOutsideBbox(ea, eb, /*asSegment=*/true)) continue;
 
         Point2d puv;
@@ -603,6 +724,7 @@ bool SShell::ClassifyEdge(Class *indir, Class *outdir,
         if(cnt > 5) {
             dbp("can't find a ray that doesn't hit on edge!");
             dbp("on edge = %d, edge_inters = %d", onEdge, edge_inters);
+#pragma omp critical
             SS.nakedEdges.AddEdge(ea, eb);
             break;
         }
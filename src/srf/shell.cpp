@@ -259,7 +259,7 @@ void SShell::MakeFromHelicalRevolutionOf(SBezierLoopSet *sbls, Vector pt, Vector
                 double ps = 0.0;
                 t_values.Add(&ps);
                 (surface.FindById(revs[0]))->MakeTriangulationGridInto(
-                        &t_values, 0.0, 1.0, true, 0);
+                        &t_values, 0.0, 1.0, true, 0, SS.ChordTolMm());
             }
             // we generate one more curve than we did surfaces
             for(j = 0; j <= sections; j++) {
@@ -585,22 +585,133 @@ void SShell::MakeSectionEdgesInto(Vector n, double d, SEdgeList *sel, SBezierLis
     }
 }
 
-void SShell::TriangulateInto(SMesh *sm) {
+//-----------------------------------------------------------------------------
+// Triangulate all our surfaces into sm, reusing whatever SS.triangulations
+// has for surfaces that haven't changed. For a preview, once we've
+// triangulated a few curved surfaces in full, the rest get triangulated
+// coarsely; returns false if any did, so that the caller knows to refine
+// them later. Which ones depends only on the shell and on the cache, not on
+// how long that took.
+//-----------------------------------------------------------------------------
+// For a preview, how many curved surfaces to triangulate in full detail, in
+// the shell's order, before the rest get this much more coarse
+static const int    PREVIEW_SURFACES   = 32;
+static const double PREVIEW_COARSENESS = 4.0;
+
+bool SShell::TriangulateInto(SMesh *sm, bool preview) {
+    STriangulationCache *cache = &SS.triangulations;
+    double chordTol = SS.ChordTolMm();
+
+    std::vector<SMesh> m(surface.n);
+    std::vector<uint64_t> key(surface.n);
+    std::vector<const SCompactMesh *> entry(surface.n);
 #pragma omp parallel for
     for(int i=0; i<surface.n; i++) {
-        SSurface *s = &surface[i];
-        SMesh m;
-        s->TriangulateInto(this, &m);
-        #pragma omp critical
-        sm->MakeFromCopyOf(&m);
-        m.Clear();
+        key[i] = surface[i].TriangulationKey(this, chordTol);
+        entry[i] = cache->Find(key[i]);
+    }
+
+    // In order, so that the same surfaces get coarse every time.
+    std::vector<char> coarse(surface.n, false);
+    if(preview) {
+        int full = 0;
+        for(int i=0; i<surface.n; i++) {
+            SSurface *s = &surface[i];
+            if(entry[i] != NULL || (s->degm == 1 && s->degn == 1)) continue;
+            if(full < PREVIEW_SURFACES) {
+                full++;
+                continue;
+            }
+            coarse[i] = true;
+            key[i] = s->TriangulationKey(this,
+                chordTol*PREVIEW_COARSENESS);
+            entry[i] = cache->Find(key[i]);
+        }
+    }
+
+#pragma omp parallel for
+    for(int i=0; i<surface.n; i++) {
+        if(entry[i] != NULL) {
+            entry[i]->MakeMeshInto(&m[i]);
+        } else {
+            double tol = chordTol;
+            if(coarse[i]) tol *= PREVIEW_COARSENESS;
+            surface[i].TriangulateInto(this, &m[i], tol);
+        }
+    }
+
+    // In order, so that the triangles don't depend on the threads.
+    bool complete = true;
+    for(int i=0; i<surface.n; i++) {
+        if(entry[i] != NULL) {
+            cache->MarkUsed(key[i]);
+        } else {
+            cache->Add(key[i])->MakeFromCopyOf(&m[i], /*exact=*/true);
+        }
+        if(coarse[i]) complete = false;
+
+        sm->MakeFromCopyOf(&m[i]);
+        m[i].Clear();
     }
+    return complete;
 }
 
 bool SShell::IsEmpty() const {
     return surface.IsEmpty();
 }
 
+//-----------------------------------------------------------------------------
+// A hash of everything that a Boolean on this shell depends upon, so that two
+// shells with the same hash will (almost certainly) give the same result. The
+// curves' source isn't included, since the Boolean sets that itself, and it's
+// lost when the shell is copied.
+//-----------------------------------------------------------------------------
+uint64_t SShell::ContentHash() {
+    ContentHasher hash;
+    hash.Add((uint32_t)surface.n);
+    for(SSurface &s : surface) {
+        hash.Add(s.h.v);
+        hash.Add(s.color.ToPackedInt());
+        hash.Add(s.face);
+        hash.Add((uint32_t)s.degm);
+        hash.Add((uint32_t)s.degn);
+        for(int i = 0; i <= s.degm; i++) {
+            for(int j = 0; j <= s.degn; j++) {
+                hash.Add(s.ctrl[i][j]);
+                hash.Add(s.weight[i][j]);
+            }
+        }
+        hash.Add((uint32_t)s.trim.n);
+        for(STrimBy &stb : s.trim) {
+            hash.Add(stb.curve.v);
+            hash.Add((uint32_t)stb.backwards);
+            hash.Add(stb.start);
+            hash.Add(stb.finish);
+        }
+    }
+
+    hash.Add((uint32_t)curve.n);
+    for(SCurve &c : curve) {
+        hash.Add(c.h.v);
+        hash.Add(c.surfA.v);
+        hash.Add(c.surfB.v);
+        hash.Add((uint32_t)c.isExact);
+        if(c.isExact) {
+            hash.Add((uint32_t)c.exact.deg);
+            for(int i = 0; i <= c.exact.deg; i++) {
+                hash.Add(c.exact.ctrl[i]);
+                hash.Add(c.exact.weight[i]);
+            }
+        }
+        hash.Add((uint32_t)c.pts.n);
+        for(SCurvePt &pt : c.pts) {
+            hash.Add(pt.p);
+            hash.Add((uint32_t)pt.vertex);
+        }
+    }
+    return hash.value;
+}
+
 void SShell::Clear() {
     for(SSurface &s : surface) {
         s.Clear();
@@ -611,4 +722,119 @@ void SShell::Clear() {
         c.Clear();
     }
     curve.Clear();
+
+    ClearBvhs();
+}
+
+//-----------------------------------------------------------------------------
+// Make the hierarchies over our surfaces and curves, unless we have them
+// already; so a shell that's used in several Booleans only gets them once.
+// The pieces of the curved surfaces are only made when they're first needed,
+// since most surfaces never get tested against a line that comes near them.
+//-----------------------------------------------------------------------------
+void SShell::MakeBvhs() {
+    uint64_t key = BvhKey();
+    if(HasBvhs() && bvhKey == key) return;
+
+    std::vector<Vector> max, min;
+    for(const SSurface &s : surface) {
+        Vector smax, smin;
+        s.GetAxisAlignedBounding(&smax, &smin);
+        max.push_back(smax);
+        min.push_back(smin);
+    }
+    surfaceBvh.Build(max, min);
+
+    max.clear();
+    min.clear();
+    for(const SCurve &c : curve) {
+        Vector cmax, cmin;
+        c.GetAxisAlignedBounding(&cmax, &cmin);
+        max.push_back(cmax);
+        min.push_back(cmin);
+    }
+    curveBvh.Build(max, min);
+
+    surfacePatches.clear();
+    surfacePatches.resize(surface.n);
+    bvhKey = key;
+}
+
+// The hierarchies are dropped whenever we change the surfaces or curves, and
+// MakeBvhs() checks what they were made from; so while a Boolean runs, and
+// its shells don't change, the counts are enough to check.
+bool SShell::HasBvhs() const {
+    return surfaceBvh.Size() == surface.n && curveBvh.Size() == curve.n &&
+           (int)surfacePatches.size() == surface.n &&
+           (surface.n > 0 || curve.n > 0);
+}
+
+// Everything that the hierarchies depend on: the handles, which give the
+// order of the surfaces, and the geometry, which gives the boxes.
+uint64_t SShell::BvhKey() {
+    ContentHasher hash;
+    for(const SSurface &s : surface) {
+        hash.Add(s.h.v);
+        hash.Add((uint32_t)s.degm);
+        hash.Add((uint32_t)s.degn);
+        for(int i = 0; i <= s.degm; i++) {
+            for(int j = 0; j <= s.degn; j++) {
+                hash.Add(s.ctrl[i][j]);
+                hash.Add(s.weight[i][j]);
+            }
+        }
+    }
+    for(const SCurve &c : curve) {
+        hash.Add(c.h.v);
+        hash.Add((uint32_t)c.exact.deg);
+        for(int i = 0; i <= c.exact.deg; i++) {
+            hash.Add(c.exact.ctrl[i]);
+        }
+    }
+    return hash.value;
+}
+
+void SShell::ClearBvhs() {
+    surfaceBvh.Clear();
+    curveBvh.Clear();
+    surfacePatches.clear();
+}
+
+// The pieces of our i-th surface, which are made the first time that someone
+// asks for them. Planes and cylinders get intersected in closed form, so they
+// never have any. If another thread is making them right now, then we return
+// NULL, and the caller splits the surface itself, finding the same points.
+const SPatchTree *SShell::PatchesAt(int i) {
+    SPatchTree *pt = &surfacePatches[i];
+    int state = SPatchTree::UNBUILT;
+    if(!pt->state.compare_exchange_strong(state, SPatchTree::BUILDING)) {
+        return (state == SPatchTree::BUILT) ? pt : NULL;
+    }
+
+    SSurface *s = &surface[i];
+    Vector axis, center, start, finish;
+    double radius;
+    if(!(s->degm == 1 && s->degn == 1) &&
+       !s->IsCylinder(&axis, &center, &radius, &start, &finish))
+    {
+        pt->Build(s);
+    }
+    pt->state = SPatchTree::BUILT;
+    return pt;
+}
+
+const SPatchTree *SShell::PatchesFor(hSSurface hs) {
+    if(!HasBvhs()) return NULL;
+    // The surfaces are in order of their handles.
+    int lo = 0, hi = surface.n;
+    while(lo < hi) {
+        int mid = (lo + hi) / 2;
+        if(surface[mid].h.v < hs.v) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if(lo == surface.n || surface[lo].h.v != hs.v) return NULL;
+    return PatchesAt(lo);
 }
@@ -63,6 +63,65 @@ bool SSurface::IsCylinder(Vector *axis, Vector *center, double *r,
     return true;
 }
 
+//-----------------------------------------------------------------------------
+// Are we a surface of revolution, with no translation along the axis? Then
+// each row of control points is an arc about the same axis, or a single point
+// on that axis. If so, return a point on the axis and its unit direction.
+//-----------------------------------------------------------------------------
+bool SSurface::IsRevolution(Vector *axisPt, Vector *axis) const {
+    if(degn != 2) return false;
+
+    Vector n, c;
+    bool haveAxis = false;
+    int i;
+    for(i = 0; i <= degm; i++) {
+        if(ctrl[i][0].Equals(ctrl[i][1]) && ctrl[i][1].Equals(ctrl[i][2])) {
+            continue;
+        }
+
+        // The row's weights all include the profile's weight, which
+        // doesn't change the curve; so divide it out, for IsCircle().
+        SBezier sb = SBezier::From(ctrl[i][0], ctrl[i][1], ctrl[i][2]);
+        sb.weight[1] = weight[i][1] / weight[i][0];
+        sb.weight[2] = weight[i][2] / weight[i][0];
+
+        if(!haveAxis) {
+            n = ((ctrl[i][1]).Minus(ctrl[i][0])).Cross(
+                 (ctrl[i][2]).Minus(ctrl[i][1]));
+            if(n.Magnitude() < LENGTH_EPS) return false;
+            n = n.WithMagnitude(1);
+        }
+        Vector ci;
+        double r;
+        if(!sb.IsCircle(n, &ci, &r)) return false;
+        // The arc must lie in a plane normal to the axis, and be centered
+        // on it.
+        if(fabs((ctrl[i][0]).Minus(ci).Dot(n)) > LENGTH_EPS) return false;
+        if(fabs((ctrl[i][1]).Minus(ci).Dot(n)) > LENGTH_EPS) return false;
+        if(fabs((ctrl[i][2]).Minus(ci).Dot(n)) > LENGTH_EPS) return false;
+        if(!haveAxis) {
+            c = ci;
+            haveAxis = true;
+        } else if(ci.DistanceToLine(c, n) > LENGTH_EPS) {
+            return false;
+        }
+    }
+    if(!haveAxis) return false;
+
+    // And the rows that collapsed to a point must be on the axis too.
+    for(i = 0; i <= degm; i++) {
+        if(ctrl[i][0].Equals(ctrl[i][1]) && ctrl[i][1].Equals(ctrl[i][2]) &&
+           (ctrl[i][0]).DistanceToLine(c, n) > LENGTH_EPS)
+        {
+            return false;
+        }
+    }
+
+    *axisPt = c;
+    *axis = n;
+    return true;
+}
+
 // Create a surface patch by revolving and possibly translating a curve.
 // Works for sections up to but not including 180 degrees.
 SSurface SSurface::FromRevolutionOf(SBezier *sb, Vector pt, Vector axis, double thetas,
@@ -409,7 +468,44 @@ void SSurface::MakeSectionEdgesInto(SShell *shell, SEdgeList *sel, SBezierList *
     }
 }
 
-void SSurface::TriangulateInto(SShell *shell, SMesh *sm) {
+//-----------------------------------------------------------------------------
+// A hash of everything that our triangulation to within chordTol depends upon:
+// our shape and trim, and what we'd write into each triangle's meta. We hash
+// the trim in xyz, since the uv edges that we'll actually triangulate take
+// much longer to compute.
+//-----------------------------------------------------------------------------
+uint64_t SSurface::TriangulationKey(SShell *shell, double chordTol) {
+    SEdgeList el = {};
+    MakeEdgesInto(shell, &el, MakeAs::XYZ);
+
+    ContentHasher hash;
+    hash.Add(chordTol);
+    hash.Add((uint32_t)SS.GetMaxSegments());
+    hash.Add(face);
+    hash.Add(color.ToPackedInt());
+    hash.Add((uint32_t)degm);
+    hash.Add((uint32_t)degn);
+    for(int i = 0; i <= degm; i++) {
+        for(int j = 0; j <= degn; j++) {
+            hash.Add(ctrl[i][j]);
+            hash.Add(weight[i][j]);
+        }
+    }
+    hash.Add((uint32_t)el.l.n);
+    for(const SEdge &se : el.l) {
+        hash.Add(se.a);
+        hash.Add(se.b);
+    }
+    el.Clear();
+    return hash.value;
+}
+
+void SSurface::TriangulateInto(SShell *shell, SMesh *sm, double chordTol) {
+    if(EXACT(chordTol == 0)) {
+        // Use the default chord tolerance.
+        chordTol = SS.ChordTolMm();
+    }
+
     SEdgeList el = {};
 
     MakeEdgesInto(shell, &el, MakeAs::UV);
@@ -426,23 +522,38 @@ void SSurface::TriangulateInto(SShell *shell, SMesh *sm) {
             //
             // If this is just a plane (degree (1, 1)) then the triangulation
             // code will notice that, and not bother checking chord tols.
-            poly.UvTriangulateInto(sm, this);
+            poly.UvTriangulateInto(sm, this, chordTol);
         } else {
             // A surface with compound curvature. So we must overlay a
             // two-dimensional grid, and triangulate around that.
-            poly.UvGridTriangulateInto(sm, this);
+            poly.UvGridTriangulateInto(sm, this, chordTol);
+        }
+
+        // Map the uv vertices onto the surface in one batch.
+        int nv = 3*(sm->l.n - start);
+        std::vector<double> u(nv), v(nv);
+        std::vector<Vector> pt(nv), nrm(nv);
+        for(i = start; i < sm->l.n; i++) {
+            const STriangle *st = &(sm->l[i]);
+            int k = 3*(i - start);
+            u[k]   = st->a.x; v[k]   = st->a.y;
+            u[k+1] = st->b.x; v[k+1] = st->b.y;
+            u[k+2] = st->c.x; v[k+2] = st->c.y;
         }
+        PointsAt(u.data(), v.data(), nv, pt.data());
+        NormalsAt(u.data(), v.data(), nv, nrm.data());
 
         STriMeta meta = { face, color };
         for(i = start; i < sm->l.n; i++) {
             STriangle *st = &(sm->l[i]);
+            int k = 3*(i - start);
             st->meta = meta;
-            st->an = NormalAt(st->a.x, st->a.y);
-            st->bn = NormalAt(st->b.x, st->b.y);
-            st->cn = NormalAt(st->c.x, st->c.y);
-            st->a = PointAt(st->a.x, st->a.y);
-            st->b = PointAt(st->b.x, st->b.y);
-            st->c = PointAt(st->c.x, st->c.y);
+            st->an = nrm[k];
+            st->bn = nrm[k+1];
+            st->cn = nrm[k+2];
+            st->a = pt[k];
+            st->b = pt[k+1];
+            st->c = pt[k+2];
             // Works out that my chosen contour direction is inconsistent with
             // the triangle direction, sigh.
             st->FlipNormal();
@@ -487,6 +598,7 @@ void SSurface::ScaleSelfBy(double s) {
 
 void SSurface::Clear() {
     trim.Clear();
+    bsp.reset();
 }
 
 
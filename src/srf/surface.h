@@ -12,18 +12,26 @@
 
 class SBezierList;
 class SSurface;
+class SPatchTree;
+class SNewCurve;
 class SCurvePt;
 
 // Utility data structure, a two-dimensional BSP to accelerate polygon
-// operations.
+// operations. The nodes are stored flat, and refer to each other by index.
 class SBspUv {
 public:
-    Point2d  a, b;
+    class Node {
+    public:
+        Point2d  a, b;
+        // Precomputed b - a, which gets scaled for each point we test
+        Point2d  ba;
 
-    SBspUv  *pos;
-    SBspUv  *neg;
+        int      pos;
+        int      neg;
 
-    SBspUv  *more;
+        int      more;
+    };
+    std::vector<Node> node;
 
     enum class Class : uint32_t {
         INSIDE            = 100,
@@ -33,19 +41,21 @@ public:
         EDGE_OTHER        = 500
     };
 
-    static SBspUv *Alloc();
-    static SBspUv *From(SEdgeList *el, SSurface *srf);
+    static std::shared_ptr<SBspUv> From(SEdgeList *el, SSurface *srf);
 
-    void ScalePoints(Point2d *pt, Point2d *a, Point2d *b, SSurface *srf) const;
-    double ScaledSignedDistanceToLine(Point2d pt, Point2d a, Point2d b,
-        SSurface *srf) const;
-    double ScaledDistanceToLine(Point2d pt, Point2d a, Point2d b, bool asSegment,
-        SSurface *srf) const;
+    static Point2d ScaleAt(Point2d pt, SSurface *srf);
+    double ScaledSignedDistanceToLine(int i, Point2d pt, Point2d s) const;
+    double ScaledDistanceToLine(int i, Point2d pt, Point2d s, bool asSegment) const;
 
-    void InsertEdge(Point2d a, Point2d b, SSurface *srf);
-    static SBspUv *InsertOrCreateEdge(SBspUv *where, Point2d ea, Point2d eb, SSurface *srf);
+    int AddNode(Point2d a, Point2d b);
+    int InsertOrCreateEdge(int where, Point2d ea, Point2d sa,
+                           Point2d eb, Point2d sb, SSurface *srf);
+    void InsertEdge(int i, Point2d ea, Point2d sa,
+                    Point2d eb, Point2d sb, SSurface *srf);
+    Class ClassifyPoint(int i, Point2d p, Point2d s, Point2d eb, SSurface *srf) const;
     Class ClassifyPoint(Point2d p, Point2d eb, SSurface *srf) const;
     Class ClassifyEdge(Point2d ea, Point2d eb, SSurface *srf) const;
+    double MinimumDistanceToEdge(int i, Point2d p, Point2d s) const;
     double MinimumDistanceToEdge(Point2d p, SSurface *srf) const;
 };
 
@@ -84,6 +94,7 @@ public:
     uint32_t        entity;
 
     Vector PointAt(double t) const;
+    void PointsAt(const double *t, int n, Vector *pt) const;
     Vector TangentAt(double t) const;
     void ClosestPointTo(Vector p, double *t, bool mustConverge=true) const;
     void SplitAt(double t, SBezier *bef, SBezier *aft) const;
@@ -105,6 +116,7 @@ public:
     void Reverse();
 
     bool IsInPlane(Vector n, double d) const;
+    bool PlaneCrossings(Vector n, double d, List<double> *lt) const;
     bool IsCircle(Vector axis, Vector *center, double *r) const;
     bool IsRational() const;
 
@@ -222,6 +234,20 @@ public:
     void GetAxisAlignedBounding(Vector *ptMax, Vector *ptMin) const;
 };
 
+// An intersection curve that we've found but not yet added to the result of
+// a Boolean. We find them in parallel, and then add them in a fixed order; see
+// SShell::AddIntersectionCurve().
+class SNewCurve {
+public:
+    SCurve          sc;
+    SSurface        *srfA;
+    SSurface        *srfB;
+    // Whether the curve comes close enough to lie within both surfaces
+    bool            within;
+
+    void SplitAgainst(SShell *agnstA, SShell *agnstB);
+};
+
 // A segment of a curve by which a surface is trimmed: indicates which curve,
 // by its handle, and the starting and ending points of our segment of it.
 // The vector out points out of the surface; it, the surface outer normal,
@@ -276,8 +302,11 @@ public:
 
     List<STrimBy>   trim;
 
-    // For testing whether a point (u, v) on the surface lies inside the trim
-    SBspUv          *bsp;
+    // For testing whether a point (u, v) on the surface lies inside the trim.
+    // This is kept until our trim (or shape) changes, which we notice by
+    // the hash of the xyz edges and control points in bspKey.
+    std::shared_ptr<SBspUv> bsp;
+    uint64_t        bspKey;
     SEdgeList       edges;
 
     // For caching our initial (u, v) when doing Newton iterations to project
@@ -303,9 +332,14 @@ public:
                                     SShell *into, SSurface::CombineAs type, int dbg_index);
     void TrimFromEdgeList(SEdgeList *el, bool asUv);
     void IntersectAgainst(SSurface *b, SShell *agnstA, SShell *agnstB,
-                          SShell *into);
+                          std::vector<SNewCurve> *found);
     void AddExactIntersectionCurve(SBezier *sb, SSurface *srfB,
-                          SShell *agnstA, SShell *agnstB, SShell *into);
+                          std::vector<SNewCurve> *found);
+    bool ContainsCurvePoints(SCurve *sc, SSurface *srfB);
+    bool IntersectPlaneAgainstRevolution(SSurface *b,
+                          std::vector<SNewCurve> *found);
+    bool IntersectParallelCylinders(SSurface *b, Vector axis0, Vector axis1,
+                          std::vector<SNewCurve> *found);
 
     typedef struct {
         int     tag;
@@ -320,7 +354,8 @@ public:
     void SplitInHalf(bool byU, SSurface *sa, SSurface *sb);
     void AllPointsIntersecting(Vector a, Vector b,
                                List<SInter> *l,
-                               bool asSegment, bool trimmed, bool inclTangent);
+                               bool asSegment, bool trimmed, bool inclTangent,
+                               const SPatchTree *patches=NULL);
     void AllPointsIntersectingUntrimmed(Vector a, Vector b,
                                         int *cnt, int *level,
                                         List<Inter> *l, bool asSegment,
@@ -339,6 +374,8 @@ public:
     void TangentsAt(double u, double v, Vector *tu, Vector *tv, bool retry=true) const;
     Vector NormalAt(Point2d puv) const;
     Vector NormalAt(double u, double v) const;
+    void PointsAt(const double *u, const double *v, int n, Vector *pt) const;
+    void NormalsAt(const double *u, const double *v, int n, Vector *nrm) const;
     bool LineEntirelyOutsideBbox(Vector a, Vector b, bool asSegment) const;
     void GetAxisAlignedBounding(Vector *ptMax, Vector *ptMin) const;
     bool CoincidentWithPlane(Vector n, double d) const;
@@ -347,8 +384,11 @@ public:
     bool IsExtrusion(SBezier *of, Vector *along) const;
     bool IsCylinder(Vector *axis, Vector *center, double *r,
                         Vector *start, Vector *finish) const;
+    bool IsRevolution(Vector *axisPt, Vector *axis) const;
+    SBezier IsoparametricCurve(bool constU, double t) const;
 
-    void TriangulateInto(SShell *shell, SMesh *sm);
+    void TriangulateInto(SShell *shell, SMesh *sm, double chordTol=0);
+    uint64_t TriangulationKey(SShell *shell, double chordTol);
 
     // these are intended as bitmasks, even though there's just one now
     enum class MakeAs : uint32_t {
@@ -365,14 +405,53 @@ public:
     void MakeClassifyingBsp(SShell *shell, SShell *useCurvesFrom);
     double ChordToleranceForEdge(Vector a, Vector b) const;
     void MakeTriangulationGridInto(List<double> *l, double vs, double vf,
-                                    bool swapped, int depth) const;
-    Vector PointAtMaybeSwapped(double u, double v, bool swapped) const;
-    Vector NormalAtMaybeSwapped(double u, double v, bool swapped) const;
+                                    bool swapped, int depth, double chordTol) const;
 
     void Reverse();
     void Clear();
 };
 
+// The pieces into which AllPointsIntersectingUntrimmed() would split a curved
+// surface, with their bounding boxes. We make these once, so that many lines
+// can be tested against the surface without splitting it again for each one.
+class SPatchTree {
+public:
+    enum { MAX_NODES = 4096, MAX_DEPTH = 24 };
+    // A shell makes them when they're first asked for, maybe from several
+    // threads at once; see SShell::PatchesAt().
+    enum State { UNBUILT = 0, BUILDING = 1, BUILT = 2 };
+    struct Node {
+        Vector  max, min;
+        // The first half is the next node, and the second is node[right];
+        // or, if right is -1, this is a leaf, small enough that we start
+        // Newton's method at p.
+        Vector  p;
+        int     right;
+    };
+    std::vector<Node>   node;
+    // The tolerance that decided how small a leaf must be
+    double              chordTol;
+    std::atomic<int>    state;
+
+    SPatchTree() : chordTol(0.0), state(UNBUILT) {}
+    SPatchTree(const SPatchTree &other) :
+        node(other.node), chordTol(other.chordTol), state(other.state.load()) {}
+    SPatchTree &operator=(const SPatchTree &other) {
+        node     = other.node;
+        chordTol = other.chordTol;
+        state    = other.state.load();
+        return *this;
+    }
+
+    void Build(SSurface *srf);
+    bool BuildNode(SSurface *srf, int level);
+    bool IsUsable() const;
+    void AllPointsIntersecting(Vector a, Vector b, List<SSurface::Inter> *l,
+                               bool asSegment, SSurface *sorig) const;
+
+    void Clear();
+};
+
 class SShell {
 public:
     IdList<SCurve,hSCurve>      curve;
@@ -380,6 +459,16 @@ public:
 
     bool                        booleanFailed;
 
+    // Over the bounding boxes of the surfaces and of the curves, by index;
+    // made by MakeBvhs(), and kept until the shell changes.
+    SBvh                        surfaceBvh;
+    SBvh                        curveBvh;
+    // And for each curved surface, its pieces, once they're asked for;
+    // empty for the others
+    std::vector<SPatchTree>     surfacePatches;
+    // The contents that those were made for; see BvhKey()
+    uint64_t                    bvhKey;
+
     void MakeFromExtrusionOf(SBezierLoopSet *sbls, Vector t0, Vector t1,
                              RgbaColor color);
     bool CheckNormalAxisRelationship(SBezierLoopSet *sbls, Vector pt, Vector axis, double da, double dx);
@@ -395,7 +484,14 @@ public:
     void CopyCurvesSplitAgainst(bool opA, SShell *agnst, SShell *into);
     void CopySurfacesTrimAgainst(SShell *sha, SShell *shb, SShell *into, SSurface::CombineAs type);
     void MakeIntersectionCurvesAgainst(SShell *against, SShell *into);
+    void AddIntersectionCurve(SNewCurve *nc);
     void MakeClassifyingBsps(SShell *useCurvesFrom);
+    void MakeBvhs();
+    bool HasBvhs() const;
+    uint64_t BvhKey();
+    void ClearBvhs();
+    const SPatchTree *PatchesAt(int i);
+    const SPatchTree *PatchesFor(hSSurface hs);
     void AllPointsIntersecting(Vector a, Vector b, List<SInter> *il,
                                 bool asSegment, bool trimmed, bool inclTangent);
     void MakeCoincidentEdgesInto(SSurface *proto, bool sameNormal,
@@ -427,13 +523,59 @@ public:
     void MakeFromAssemblyOf(SShell *a, SShell *b);
     void MergeCoincidentSurfaces();
 
-    void TriangulateInto(SMesh *sm);
+    bool TriangulateInto(SMesh *sm, bool preview=false);
     void MakeEdgesInto(SEdgeList *sel);
     void MakeSectionEdgesInto(Vector n, double d, SEdgeList *sel, SBezierList *sbl);
     bool IsEmpty() const;
     void RemapFaces(Group *g, int remap);
+    uint64_t ContentHash();
+    void Clear();
+};
+
+// The curves in which pairs of surfaces intersect, as found by
+// SSurface::IntersectAgainst() and before they're split against the rest of
+// their shells. These are kept across regenerations, by the content hashes of
+// the two surfaces, so that a Boolean only has to intersect those surfaces
+// that have actually changed since last time.
+class SIntersectionCurves {
+public:
+    // With surfA and surfB as they were when we found them
+    std::vector<SCurve> curves;
+
+    void MakeFromCopyOf(const SNewCurve *first, const SNewCurve *last);
+    void CopyInto(SSurface *srfA, SSurface *srfB, std::vector<SNewCurve> *found) const;
+    size_t Size() const { return curves.size(); }
     void Clear();
 };
 
+struct SIntersectionKey {
+    uint64_t    hashA;
+    uint64_t    hashB;
+    // The pwl curves depend on these too
+    double      chordTol;
+    int         maxSegments;
+
+    bool operator==(const SIntersectionKey &k) const {
+        return hashA == k.hashA && hashB == k.hashB &&
+               EXACT(chordTol == k.chordTol) && maxSegments == k.maxSegments;
+    }
+};
+struct SIntersectionKeyHash {
+    size_t operator()(const SIntersectionKey &k) const {
+        return (size_t)(k.hashA ^ (k.hashB * 31));
+    }
+};
+typedef GenerationCache<SIntersectionKey, SIntersectionCurves,
+                        SIntersectionKeyHash> SIntersectionCache;
+
+// The triangles of recently triangulated surfaces, by their
+// SSurface::TriangulationKey(); so that when we regenerate, we only have to
+// triangulate those surfaces that actually changed. That's a second copy of
+// every surface's triangles, so they're kept in the compact form, and the
+// least recently used get forgotten once there are more than 2^18 triangles
+// in total.
+typedef GenerationCache<uint64_t, SCompactMesh, std::hash<uint64_t>,
+                        (1 << 18)> STriangulationCache;
+
 #endif
 
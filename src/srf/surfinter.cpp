@@ -10,7 +10,7 @@
 extern int FLAG;
 
 void SSurface::AddExactIntersectionCurve(SBezier *sb, SSurface *srfB,
-                                         SShell *agnstA, SShell *agnstB, SShell *into)
+                                         std::vector<SNewCurve> *found)
 {
     SCurve sc = {};
     // Important to keep the order of (surfA, surfB) consistent; when we later
@@ -20,48 +20,41 @@ void SSurface::AddExactIntersectionCurve(SBezier *sb, SSurface *srfB,
     sc.exact = *sb;
     sc.isExact = true;
 
-    // Now we have to piecewise linearize the curve. If there's already an
-    // identical curve in the shell, then follow that pwl exactly, otherwise
-    // calculate from scratch.
-    SCurve split, *existing = NULL;
-    SBezier sbrev = *sb;
-    sbrev.Reverse();
-    bool backwards = false;
-#pragma omp critical(into)
-    {
-        for(SCurve &se : into->curve) {
-            if(se.isExact) {
-                if(sb->Equals(&(se.exact))) {
-                    existing = &se;
-                    break;
-                }
-                if(sbrev.Equals(&(se.exact))) {
-                    existing = &se;
-                    backwards = true;
-                    break;
-                }
-            }
-        }
-    }// end omp critical
-    if(existing) {
-        SCurvePt *v;
-        for(v = existing->pts.First(); v; v = existing->pts.NextAfter(v)) {
-            sc.pts.Add(v);
-        }
-        if(backwards) sc.pts.Reverse();
-        split = sc;
-        sc = {};
-    } else {
-        sb->MakePwlInto(&(sc.pts));
-        // and split the line where it intersects our existing surfaces
-        split = sc.MakeCopySplitAgainst(agnstA, agnstB, this, srfB);
-        sc.Clear();
-    }
+    // Now we have to piecewise linearize the curve. It gets split where it
+    // intersects our existing surfaces later, in SNewCurve::SplitAgainst(),
+    // since the result up to here depends on the two surfaces alone.
+    sb->MakePwlInto(&(sc.pts));
+    SNewCurve nc = {};
+    nc.sc = sc;
+    nc.srfA = this;
+    nc.srfB = srfB;
+
+    found->push_back(nc);
+}
 
-    // Test if the curve lies entirely outside one of the
+//-----------------------------------------------------------------------------
+// Split a curve as found by SSurface::IntersectAgainst() where it intersects
+// the surfaces of both shells, and decide whether it's real. If there's
+// already an identical curve in the shell then we'll follow that pwl exactly
+// instead, but we can't know that until the curves before this one have been
+// added.
+//-----------------------------------------------------------------------------
+void SNewCurve::SplitAgainst(SShell *agnstA, SShell *agnstB) {
+    SCurve split = sc.MakeCopySplitAgainst(agnstA, agnstB, srfA, srfB);
+    sc.Clear();
+    sc = split;
+    // Curves that we marched along lie on both surfaces by construction.
+    within = sc.isExact ? srfA->ContainsCurvePoints(&sc, srfB) : true;
+}
+
+//-----------------------------------------------------------------------------
+// Test if the curve lies at least partly within the [0, 1] parameter range of
+// both our surface and srfB; if not, then it's fake.
+//-----------------------------------------------------------------------------
+bool SSurface::ContainsCurvePoints(SCurve *sc, SSurface *srfB) {
     SCurvePt *scpt;
     bool withinA = false, withinB = false;
-    for(scpt = split.pts.First(); scpt; scpt = split.pts.NextAfter(scpt)) {
+    for(scpt = sc->pts.First(); scpt; scpt = sc->pts.NextAfter(scpt)) {
         double tol = 0.01;
         Point2d puv;
         ClosestPointTo(scpt->p, &puv);
@@ -79,39 +72,245 @@ void SSurface::AddExactIntersectionCurve(SBezier *sb, SSurface *srfB,
         // Break out early, no sense wasting time if we already have the answer.
         if(withinA && withinB) break;
     }
-    if(!(withinA && withinB)) {
+    return withinA && withinB;
+}
+
+//-----------------------------------------------------------------------------
+// Add an intersection curve to our shell. The curves must be added in the same
+// order every time, so that their handles, and any pwl that an exact curve
+// copies from an identical one that's already here, don't depend on how the
+// work got divided between threads.
+//-----------------------------------------------------------------------------
+void SShell::AddIntersectionCurve(SNewCurve *nc) {
+    SCurve *sc = &(nc->sc);
+    if(sc->isExact) {
+        SCurve *existing = NULL;
+        SBezier sbrev = sc->exact;
+        sbrev.Reverse();
+        bool backwards = false;
+        for(SCurve &se : curve) {
+            if(se.isExact) {
+                if(sc->exact.Equals(&(se.exact))) {
+                    existing = &se;
+                    break;
+                }
+                if(sbrev.Equals(&(se.exact))) {
+                    existing = &se;
+                    backwards = true;
+                    break;
+                }
+            }
+        }
+        if(existing) {
+            sc->pts.Clear();
+            SCurvePt *v;
+            for(v = existing->pts.First(); v; v = existing->pts.NextAfter(v)) {
+                sc->pts.Add(v);
+            }
+            if(backwards) sc->pts.Reverse();
+            nc->within = nc->srfA->ContainsCurvePoints(sc, nc->srfB);
+        }
+    }
+
+    if(!nc->within) {
         // Intersection curve lies entirely outside one of the surfaces, so
         // it's fake.
-        split.Clear();
+        sc->Clear();
         return;
     }
+    if(sc->isExact) {
+        ssassert(!(sc->exact.Start()).Equals(sc->exact.Finish()),
+                 "Unexpected zero-length edge");
+    }
+
+    sc->source = SCurve::Source::INTERSECTION;
+    curve.AddAndAssignId(sc);
+}
+
+//-----------------------------------------------------------------------------
+// A plane against a surface of revolution, in the two cases where the curves
+// are exact: if the plane is normal to the axis, then they're arcs of constant
+// u where the profile crosses the plane; and if the plane contains the axis,
+// then they're profiles of constant v. Returns false if it's neither of those,
+// or if the plane is tangent to the surface or passes through one of its
+// edges, so that the general code must handle it.
+//-----------------------------------------------------------------------------
+bool SSurface::IntersectPlaneAgainstRevolution(SSurface *b,
+                                               std::vector<SNewCurve> *found)
+{
+    SSurface *splane, *srev;
+    if(degm == 1 && degn == 1) {
+        splane = this;
+        srev = b;
+    } else if(b->degm == 1 && b->degn == 1) {
+        splane = b;
+        srev = this;
+    } else {
+        return false;
+    }
+
+    Vector axisPt, axis;
+    if(!srev->IsRevolution(&axisPt, &axis)) return false;
+
+    Vector n = splane->NormalAt(0, 0).WithMagnitude(1);
+    double d = n.Dot(splane->PointAt(0, 0));
 
-#if 0
-    if(sb->deg == 2) {
-        dbp(" ");
-        SCurvePt *prev = NULL, *v;
-        dbp("split.pts.n = %d", split.pts.n);
-        for(v = split.pts.First(); v; v = split.pts.NextAfter(v)) {
-            if(prev) {
-                Vector e = (prev->p).Minus(v->p).WithMagnitude(0);
-                SS.nakedEdges.AddEdge((prev->p).Plus(e), (v->p).Minus(e));
+    bool constU;
+    SBezier sb;
+    if((n.Cross(axis)).Magnitude() < LENGTH_EPS) {
+        sb = srev->IsoparametricCurve(/*constU=*/false, 0);
+        constU = true;
+    } else if(fabs(n.Dot(axis)) < LENGTH_EPS &&
+              fabs(n.Dot(axisPt) - d) < LENGTH_EPS)
+    {
+        // Every arc crosses the plane at the same v, so use the one that's
+        // farthest from the axis.
+        int i, im = 0;
+        for(i = 1; i <= srev->degm; i++) {
+            if((srev->ctrl[i][0]).DistanceToLine(axisPt, axis) >
+               (srev->ctrl[im][0]).DistanceToLine(axisPt, axis))
+            {
+                im = i;
             }
-            prev = v;
         }
+        sb = SBezier::From(srev->ctrl[im][0], srev->ctrl[im][1], srev->ctrl[im][2]);
+        sb.weight[0] = srev->weight[im][0];
+        sb.weight[1] = srev->weight[im][1];
+        sb.weight[2] = srev->weight[im][2];
+        constU = false;
+    } else {
+        return false;
     }
-#endif // 0
-    ssassert(!(sb->Start()).Equals(sb->Finish()),
-             "Unexpected zero-length edge");
 
-    split.source = SCurve::Source::INTERSECTION;
-#pragma omp critical(into)
+    List<double> lt = {};
+    if(!sb.PlaneCrossings(n, d, &lt)) {
+        lt.Clear();
+        return false;
+    }
+    for(double t : lt) {
+        SBezier bezier = srev->IsoparametricCurve(constU, t);
+        // An arc of zero radius, where the profile crosses the axis
+        if((bezier.Start()).Equals(bezier.Finish())) continue;
+        AddExactIntersectionCurve(&bezier, b, found);
+    }
+    lt.Clear();
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Does a point on a cylinder's circle lie on the arc from s to f? All these
+// points are in the same plane, normal to the cylinder's axis n.
+//-----------------------------------------------------------------------------
+static bool PointOnArc(Vector p, Vector c, double r, Vector s, Vector f, Vector n) {
+    Vector u = (s.Minus(c)).WithMagnitude(1),
+           v = n.Cross(u);
+    double dp = WRAP_SYMMETRIC(atan2((p.Minus(c)).Dot(v), (p.Minus(c)).Dot(u)), 2*PI),
+           df = WRAP_SYMMETRIC(atan2((f.Minus(c)).Dot(v), (f.Minus(c)).Dot(u)), 2*PI);
+    double tol = LENGTH_EPS/r;
+
+    if((df > 0 && ((dp < -tol) || (dp > df + tol))) ||
+       (df < 0 && ((dp >  tol) || (dp < df - tol))))
     {
-        into->curve.AddAndAssignId(&split);
+        return false;
+    }
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Two cylinders with parallel axes meet along lines through the points where
+// their circles intersect, which we can find in closed form. The lines run
+// from axis0 to axis1. Returns false if the cylinders are coincident or
+// tangent, so that the general code must handle them.
+//-----------------------------------------------------------------------------
+bool SSurface::IntersectParallelCylinders(SSurface *b, Vector axis0, Vector axis1,
+                                          std::vector<SNewCurve> *found)
+{
+    Vector axisa, ca, sa, fa, axisb, cb, sb, fb;
+    double ra, rb;
+    if(!   IsCylinder(&axisa, &ca, &ra, &sa, &fa)) return false;
+    if(!b->IsCylinder(&axisb, &cb, &rb, &sb, &fb)) return false;
+
+    // Work in the plane through the origin, normal to the axis.
+    Vector n = axisa.WithMagnitude(1);
+    ca = ca.Minus(n.ScaledBy(ca.Dot(n)));
+    sa = sa.Minus(n.ScaledBy(sa.Dot(n)));
+    fa = fa.Minus(n.ScaledBy(fa.Dot(n)));
+    cb = cb.Minus(n.ScaledBy(cb.Dot(n)));
+    sb = sb.Minus(n.ScaledBy(sb.Dot(n)));
+    fb = fb.Minus(n.ScaledBy(fb.Dot(n)));
+
+    Vector dc = cb.Minus(ca);
+    double dist = dc.Magnitude();
+    if(dist < LENGTH_EPS) {
+        // Coaxial, so either coincident or they never meet.
+        return fabs(ra - rb) > LENGTH_EPS;
+    }
+    if(fabs(dist - (ra + rb)) < LENGTH_EPS ||
+       fabs(dist - fabs(ra - rb)) < LENGTH_EPS)
+    {
+        return false;
+    }
+    if(dist > ra + rb || dist < fabs(ra - rb)) return true;
+
+    Vector ex = dc.ScaledBy(1/dist),
+           ey = n.Cross(ex);
+    double x = (dist*dist + ra*ra - rb*rb)/(2*dist),
+           y = sqrt(max(0.0, ra*ra - x*x));
+    int i;
+    for(i = 0; i < 2; i++) {
+        Vector p = ca.Plus(ex.ScaledBy(x)).Plus(ey.ScaledBy((i == 0) ? y : -y));
+        if(!PointOnArc(p, ca, ra, sa, fa, n)) continue;
+        if(!PointOnArc(p, cb, rb, sb, fb, n)) continue;
+
+        SBezier bezier = SBezier::From(p.Plus(axis0), p.Plus(axis1));
+        AddExactIntersectionCurve(&bezier, b, found);
+    }
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Find a point on two cylinders with perpendicular axes, near p. We keep p's
+// angle about one axis and solve for its position along that axis, which is
+// a quadratic; but that's ill-conditioned where the curve runs along the
+// axis, so we use whichever cylinder gives the bigger discriminant. Returns
+// false if neither gives a solution.
+//-----------------------------------------------------------------------------
+static bool PointOnPerpendicularCylinders(Vector p, Vector ca, Vector na, double ra,
+                                          Vector cb, Vector nb, double rb,
+                                          Vector *pc)
+{
+    bool found = false;
+    double best = 0;
+    int k;
+    for(k = 0; k < 2; k++) {
+        Vector c0 = (k == 0) ? ca : cb, n0 = (k == 0) ? na : nb,
+               c1 = (k == 0) ? cb : ca, n1 = (k == 0) ? nb : na;
+        double r0 = (k == 0) ? ra : rb, r1 = (k == 0) ? rb : ra;
+
+        Vector q = p.Minus(c0);
+        double z = q.Dot(n0);
+        Vector radial = q.Minus(n0.ScaledBy(z));
+        if(radial.Magnitude() < LENGTH_EPS) continue;
+        Vector p0 = c0.Plus(radial.WithMagnitude(r0));
+
+        // Slide p0 by s along n0, until it's r1 from the other axis.
+        Vector w = p0.Minus(c1);
+        w = w.Minus(n1.ScaledBy(w.Dot(n1)));
+        double h = w.Dot(n0),
+               disc = h*h - w.MagSquared() + r1*r1;
+        if(disc < 0 || (found && disc <= best)) continue;
+
+        double s0 = -h - sqrt(disc), s1 = -h + sqrt(disc);
+        double s = (fabs(s0 - z) < fabs(s1 - z)) ? s0 : s1;
+        *pc = p0.Plus(n0.ScaledBy(s));
+        best = disc;
+        found = true;
     }
+    return found;
 }
 
 void SSurface::IntersectAgainst(SSurface *b, SShell *agnstA, SShell *agnstB,
-                                SShell *into)
+                                std::vector<SNewCurve> *found)
 {
     Vector amax, amin, bmax, bmin;
     GetAxisAlignedBounding(&amax, &amin);
@@ -185,7 +384,7 @@ void SSurface::IntersectAgainst(SSurface *b, SShell *agnstA, SShell *agnstB,
         if(tmax > tmin + LENGTH_EPS) {
             SBezier bezier = SBezier::From(p.Plus(dl.ScaledBy(tmin)),
                                            p.Plus(dl.ScaledBy(tmax)));
-            AddExactIntersectionCurve(&bezier, b, agnstA, agnstB, into);
+            AddExactIntersectionCurve(&bezier, b, found);
         }
     } else if((degm == 1 && degn == 1 && isExtdb) ||
               (b->degm == 1 && b->degn == 1 && isExtdt))
@@ -230,7 +429,7 @@ void SSurface::IntersectAgainst(SSurface *b, SShell *agnstA, SShell *agnstB,
                 Vector al = along.ScaledBy(0.5);
                 SBezier bezier;
                 bezier = SBezier::From((si->p).Minus(al), (si->p).Plus(al));
-                AddExactIntersectionCurve(&bezier, b, agnstA, agnstB, into);
+                AddExactIntersectionCurve(&bezier, b, found);
             }
 
             inters.Clear();
@@ -246,7 +445,7 @@ void SSurface::IntersectAgainst(SSurface *b, SShell *agnstA, SShell *agnstB,
                     Vector::AtIntersectionOfPlaneAndLine(n, d, p0, p1, NULL);
             }
 
-            AddExactIntersectionCurve(&bezier, b, agnstA, agnstB, into);
+            AddExactIntersectionCurve(&bezier, b, found);
         }
     } else if(isExtdt && isExtdb &&
                 sqrt(fabs(alongt.Dot(alongb))) >
@@ -279,7 +478,12 @@ void SSurface::IntersectAgainst(SSurface *b, SShell *agnstA, SShell *agnstB,
                axis1 = axis.ScaledBy(ab_axis1),
                axisc = (axis0.Plus(axis1)).ScaledBy(0.5);
 
+        if(IntersectParallelCylinders(b, axis0, axis1, found)) {
+            return;
+        }
+
         oft.MakePwlInto(&lv);
+        const SPatchTree *patches = agnstB->PatchesFor(b->h);
 
         int i;
         for(i = 0; i < lv.n - 1; i++) {
@@ -290,7 +494,8 @@ void SSurface::IntersectAgainst(SSurface *b, SShell *agnstA, SShell *agnstB,
             pb = pb.Plus(axisc);
 
             b->AllPointsIntersecting(pa, pb, &inters,
-                /*asSegment=*/true,/*trimmed=*/false, /*inclTangent=*/false);
+                /*asSegment=*/true,/*trimmed=*/false, /*inclTangent=*/false,
+                patches);
         }
 
         SInter *si;
@@ -307,12 +512,14 @@ void SSurface::IntersectAgainst(SSurface *b, SShell *agnstA, SShell *agnstB,
 
             SBezier bezier;
             bezier = SBezier::From(p.Plus(axis0), p.Plus(axis1));
-            AddExactIntersectionCurve(&bezier, b, agnstA, agnstB, into);
+            AddExactIntersectionCurve(&bezier, b, found);
         }
 
         inters.Clear();
         lv.Clear();
     } else {
+        if(IntersectPlaneAgainstRevolution(b, found)) return;
+
         if((degm == 1 && degn == 1) || (b->degm == 1 && b->degn == 1)) {
             // we should only be here if just one surface is a plane because the
             // plane-plane case was already handled above. Need to check the other
@@ -340,7 +547,7 @@ void SSurface::IntersectAgainst(SSurface *b, SShell *agnstA, SShell *agnstB,
                 // does it lie completely in the plane?
                 if(splane->ContainsPlaneCurve(&sc)) {
                     SBezier bezier = sc.exact;
-                    AddExactIntersectionCurve(&bezier, b, agnstA, agnstB, into);
+                    AddExactIntersectionCurve(&bezier, b, found);
                     foundExact = true;
                 }
             }
@@ -357,19 +564,22 @@ void SSurface::IntersectAgainst(SSurface *b, SShell *agnstA, SShell *agnstB,
         SPointList spl = {};
         int a;
         for(a = 0; a < 2; a++) {
-            SShell   *shA  = (a == 0) ? agnstA : agnstB;
+            SShell   *shA  = (a == 0) ? agnstA : agnstB,
+                     *shB  = (a == 0) ? agnstB : agnstA;
             SSurface *srfA = (a == 0) ? this : b,
                      *srfB = (a == 0) ? b : this;
 
             SEdgeList el = {};
             srfA->MakeEdgesInto(shA, &el, MakeAs::XYZ, NULL);
+            const SPatchTree *patchesB = shB->PatchesFor(srfB->h);
 
             SEdge *se;
             for(se = el.l.First(); se; se = el.l.NextAfter(se)) {
                 List<SInter> lsi = {};
 
                 srfB->AllPointsIntersecting(se->a, se->b, &lsi,
-                    /*asSegment=*/true, /*trimmed=*/true, /*inclTangent=*/false);
+                    /*asSegment=*/true, /*trimmed=*/true, /*inclTangent=*/false,
+                    patchesB);
                 if(lsi.IsEmpty())
                     continue;
 
@@ -410,6 +620,19 @@ void SSurface::IntersectAgainst(SSurface *b, SShell *agnstA, SShell *agnstB,
             el.Clear();
         }
 
+        // Two cylinders with perpendicular axes don't (in general) meet in a
+        // curve that we can represent exactly, but we can still march along
+        // it without Newton's method.
+        Vector axisa, ca, axisb, cb, ends;
+        double ra, rb;
+        bool perpCyls =    IsCylinder(&axisa, &ca, &ra, &ends, &ends) &&
+                        b->IsCylinder(&axisb, &cb, &rb, &ends, &ends);
+        if(perpCyls) {
+            axisa = axisa.WithMagnitude(1);
+            axisb = axisb.WithMagnitude(1);
+            perpCyls = fabs(axisa.Dot(axisb)) < LENGTH_EPS;
+        }
+
         while(spl.l.n >= 2) {
             SCurve sc = {};
             sc.surfA = h;
@@ -440,11 +663,19 @@ void SSurface::IntersectAgainst(SSurface *b, SShell *agnstA, SShell *agnstB,
             // features of the curve entirely.
             double tol, step = maxtol;
             for(a = 0; a < maxsteps; a++) {
-                ClosestPointTo(start, &pa);
-                b->ClosestPointTo(start, &pb);
-
-                Vector na =    NormalAt(pa).WithMagnitude(1),
-                       nb = b->NormalAt(pb).WithMagnitude(1);
+                Vector na, nb;
+                if(perpCyls) {
+                    na = (start.Minus(ca)).Minus(axisa.ScaledBy((start.Minus(ca)).Dot(axisa)));
+                    nb = (start.Minus(cb)).Minus(axisb.ScaledBy((start.Minus(cb)).Dot(axisb)));
+                    na = na.WithMagnitude(1);
+                    nb = nb.WithMagnitude(1);
+                } else {
+                    ClosestPointTo(start, &pa);
+                    b->ClosestPointTo(start, &pb);
+
+                    na =    NormalAt(pa).WithMagnitude(1);
+                    nb = b->NormalAt(pb).WithMagnitude(1);
+                }
 
                 if(a == 0) {
                     Vector dp = nb.Cross(na);
@@ -463,7 +694,12 @@ void SSurface::IntersectAgainst(SSurface *b, SShell *agnstA, SShell *agnstB,
                     dp = dp.WithMagnitude(step);
 
                     np = start.Plus(dp);
-                    npc = ClosestPointOnThisAndSurface(b, np);
+                    if(!perpCyls ||
+                       !PointOnPerpendicularCylinders(np, ca, axisa, ra,
+                                                      cb, axisb, rb, &npc))
+                    {
+                        npc = ClosestPointOnThisAndSurface(b, np);
+                    }
                     tol = (npc.Minus(np)).Magnitude();
 
                     if(tol > maxtol*0.8) {
@@ -497,13 +733,13 @@ void SSurface::IntersectAgainst(SSurface *b, SShell *agnstA, SShell *agnstB,
 
             spl.l.RemoveTagged();
 
-            // And now we split and insert the curve
-            SCurve split = sc.MakeCopySplitAgainst(agnstA, agnstB, this, b);
-            sc.Clear();
-#pragma omp critical(into)
-            {
-                into->curve.AddAndAssignId(&split);
-            }
+            // And now we insert the curve, to be split later like the exact
+            // ones.
+            SNewCurve nc = {};
+            nc.sc = sc;
+            nc.srfA = this;
+            nc.srfB = b;
+            found->push_back(nc);
         }
         spl.Clear();
     }
@@ -593,3 +829,43 @@ void SShell::MakeCoincidentEdgesInto(SSurface *proto, bool sameNormal,
     }
 }
 
+
+//-----------------------------------------------------------------------------
+// The intersection curves between pairs of surfaces, as kept in the cache
+// across regenerations; see SShell::MakeIntersectionCurvesAgainst().
+//-----------------------------------------------------------------------------
+static SCurve CopyOfCurve(const SCurve *sc) {
+    SCurve ret = *sc;
+    ret.pts = {};
+    for(const SCurvePt &pt : sc->pts) {
+        ret.pts.Add(&pt);
+    }
+    return ret;
+}
+
+void SIntersectionCurves::MakeFromCopyOf(const SNewCurve *first, const SNewCurve *last) {
+    for(const SNewCurve *nc = first; nc != last; nc++) {
+        curves.push_back(CopyOfCurve(&(nc->sc)));
+    }
+}
+
+void SIntersectionCurves::CopyInto(SSurface *srfA, SSurface *srfB,
+                                   std::vector<SNewCurve> *found) const
+{
+    for(const SCurve &sc : curves) {
+        SNewCurve nc = {};
+        nc.sc = CopyOfCurve(&sc);
+        nc.sc.surfA = srfA->h;
+        nc.sc.surfB = srfB->h;
+        nc.srfA = srfA;
+        nc.srfB = srfB;
+        found->push_back(nc);
+    }
+}
+
+void SIntersectionCurves::Clear() {
+    for(SCurve &sc : curves) {
+        sc.Clear();
+    }
+    curves.clear();
+}
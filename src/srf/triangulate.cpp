@@ -8,7 +8,7 @@
 //-----------------------------------------------------------------------------
 #include "../solvespace.h"
 
-void SPolygon::UvTriangulateInto(SMesh *m, SSurface *srf) {
+void SPolygon::UvTriangulateInto(SMesh *m, SSurface *srf, double chordTol) {
     if(l.n <= 0) return;
 
     //int64_t in = GetMilliseconds();
@@ -88,7 +88,7 @@ void SPolygon::UvTriangulateInto(SMesh *m, SSurface *srf) {
         }
 //        dbp("finished merging holes: %d ms", (int)(GetMilliseconds() - in));
 
-        merged.UvTriangulateInto(m, srf);
+        merged.UvTriangulateInto(m, srf, chordTol);
 //        dbp("finished ear clippping: %d ms", (int)(GetMilliseconds() - in));
         merged.l.Clear();
         el.Clear();
@@ -364,7 +364,7 @@ void SContour::ClipEarInto(SMesh *m, int bp, double scaledEps) {
     l.RemoveTagged();
 }
 
-void SContour::UvTriangulateInto(SMesh *m, SSurface *srf) {
+void SContour::UvTriangulateInto(SMesh *m, SSurface *srf, double chordTol) {
     Vector tu, tv;
     srf->TangentsAt(0.5, 0.5, &tu, &tv);
     double s = sqrt(tu.MagSquared() + tv.MagSquared());
@@ -483,7 +483,7 @@ void SContour::UvTriangulateInto(SMesh *m, SSurface *srf) {
                     bestEar = ear;
                     bestChordTol = tol;
                 }
-                if(bestChordTol < 0.1*SS.ChordTolMm()) {
+                if(bestChordTol < 0.1*chordTol) {
                     break;
                 }
             }
@@ -513,53 +513,54 @@ double SSurface::ChordToleranceForEdge(Vector a, Vector b) const {
     return sqrt(worst);
 }
 
-Vector SSurface::PointAtMaybeSwapped(double u, double v, bool swapped) const {
-    if(swapped) {
-        return PointAt(v, u);
-    } else {
-        return PointAt(u, v);
-    }
-}
-
-Vector SSurface::NormalAtMaybeSwapped(double u, double v, bool swapped) const {
-    Vector du, dv;
-    if(swapped) {
-        TangentsAt(v, u, &dv, &du);
-    } else {
-        TangentsAt(u, v, &du, &dv);
-    }
-    return du.Cross(dv).WithMagnitude(1.0);
-}
-
 void SSurface::MakeTriangulationGridInto(List<double> *l, double vs, double vf,
-                                         bool swapped, int depth) const
+                                         bool swapped, int depth, double chordTol) const
 {
     double worst = 0;
 
     // Try piecewise linearizing four curves, at u = 0, 1/3, 2/3, 1; choose
-    // the worst chord tolerance of any of those.
-    double worst_twist = 1.0;
+    // the worst chord tolerance of any of those. All sixteen points (and the
+    // eight normals for the twist test) are evaluated in one batch, at
+    // rows [ps, pm1, pm2, pf] for each u.
+    double vm1 = (2*vs + vf) / 3,
+           vm2 = (vs + 2*vf) / 3;
+    double uu[16], vv[16];
+    Vector pts[16], nrm[8];
     int i;
     for(i = 0; i <= 3; i++) {
         double u = i/3.0;
+        uu[4*i] = uu[4*i+1] = uu[4*i+2] = uu[4*i+3] = u;
+        vv[4*i] = vs; vv[4*i+1] = vm1; vv[4*i+2] = vm2; vv[4*i+3] = vf;
+    }
+    // The grid runs along v; swapped means the caller's v is our u.
+    const double *pu = swapped ? vv : uu,
+                 *pv = swapped ? uu : vv;
+    PointsAt(pu, pv, 16, pts);
+
+    // 0.999 is about 2.5 degrees of twist over the middle 1/3 V-span.
+    // we don't check at the ends because the derivative may not be valid there.
+    double worst_twist = 1.0;
+    if(degm == 1) {
+        double nu[8], nv[8];
+        for(i = 0; i <= 3; i++) {
+            nu[2*i] = pu[4*i+1]; nv[2*i] = pv[4*i+1];
+            nu[2*i+1] = pu[4*i+2]; nv[2*i+1] = pv[4*i+2];
+        }
+        // Swapping the parameters would negate both normals, which leaves
+        // their dot product unchanged.
+        NormalsAt(nu, nv, 8, nrm);
+    }
 
+    for(i = 0; i <= 3; i++) {
         // This chord test should be identical to the one in SBezier::MakePwl
         // to make the piecewise linear edges line up with the grid more or
         // less.
-        Vector ps = PointAtMaybeSwapped(u, vs, swapped),
-               pf = PointAtMaybeSwapped(u, vf, swapped);
-
-        double vm1 = (2*vs + vf) / 3,
-               vm2 = (vs + 2*vf) / 3;
-
-        Vector pm1 = PointAtMaybeSwapped(u, vm1, swapped),
-               pm2 = PointAtMaybeSwapped(u, vm2, swapped);
+        Vector ps  = pts[4*i],   pm1 = pts[4*i+1],
+               pm2 = pts[4*i+2], pf  = pts[4*i+3];
 
-        // 0.999 is about 2.5 degrees of twist over the middle 1/3 V-span.
-        // we don't check at the ends because the derivative may not be valid there.
         double twist = 1.0;
-        if (degm == 1) twist = NormalAtMaybeSwapped(u, vm1, swapped).Dot(
-                               NormalAtMaybeSwapped(u, vm2, swapped) );
+        if (degm == 1) twist = nrm[2*i].WithMagnitude(1.0).Dot(
+                               nrm[2*i+1].WithMagnitude(1.0));
         if (twist < worst_twist) worst_twist = twist;
 
         worst = max(worst, pm1.DistanceToLine(ps, pf.Minus(ps)));
@@ -567,16 +568,16 @@ void SSurface::MakeTriangulationGridInto(List<double> *l, double vs, double vf,
     }
 
     double step = 1.0/SS.GetMaxSegments();
-    if( ((vf - vs) < step || worst < SS.ChordTolMm())
+    if( ((vf - vs) < step || worst < chordTol)
         && ((worst_twist > 0.999) || (depth > 3)) ) {
         l->Add(&vf);
     } else {
-        MakeTriangulationGridInto(l, vs, (vs+vf)/2, swapped, depth+1);
-        MakeTriangulationGridInto(l, (vs+vf)/2, vf, swapped, depth+1);
+        MakeTriangulationGridInto(l, vs, (vs+vf)/2, swapped, depth+1, chordTol);
+        MakeTriangulationGridInto(l, (vs+vf)/2, vf, swapped, depth+1, chordTol);
     }
 }
 
-void SPolygon::UvGridTriangulateInto(SMesh *mesh, SSurface *srf) {
+void SPolygon::UvGridTriangulateInto(SMesh *mesh, SSurface *srf, double chordTol) {
     SEdgeList orig = {};
     MakeEdgesInto(&orig);
 
@@ -592,9 +593,9 @@ void SPolygon::UvGridTriangulateInto(SMesh *mesh, SSurface *srf) {
     lj = {};
     double v[5] = {0.0, 0.25, 0.5, 0.75, 1.0};
     li.Add(&v[0]);
-    srf->MakeTriangulationGridInto(&li, 0, 1, /*swapped=*/true, 0);
+    srf->MakeTriangulationGridInto(&li, 0, 1, /*swapped=*/true, 0, chordTol);
     lj.Add(&v[0]);
-    srf->MakeTriangulationGridInto(&lj, 0, 1, /*swapped=*/false, 0);
+    srf->MakeTriangulationGridInto(&lj, 0, 1, /*swapped=*/false, 0, chordTol);
 
     // force 2nd order grid to have at least 4 segments in each direction
     if ((li.n < 5) && (srf->degm>1)) { // 4 segments minimum
@@ -705,7 +706,7 @@ void SPolygon::UvGridTriangulateInto(SMesh *mesh, SSurface *srf) {
     holes.Clear();
     li.Clear();
     lj.Clear();
-    UvTriangulateInto(mesh, srf);
+    UvTriangulateInto(mesh, srf, chordTol);
 }
 
 void SPolygon::TriangulateInto(SMesh *m) const {
@@ -723,7 +724,7 @@ void SPolygon::TriangulateInto(SMesh *m) const {
                                        Vector::From(1.0, 0.0, 0.0),
                                        Vector::From(0.0, 1.0, 0.0));
     SMesh pm = {};
-    p.UvTriangulateInto(&pm, &srf);
+    p.UvTriangulateInto(&pm, &srf, SS.ChordTolMm());
     for(STriangle st : pm.l) {
         st = st.Transform(u, v, n);
         m->AddTriangle(&st);
@@ -9,24 +9,187 @@
 #include "solvespace.h"
 
 #include <Eigen/Core>
+#include <Eigen/QR>
+#include <Eigen/SVD>
 #include <Eigen/SparseQR>
+#include <list>
+#include <mutex>
+
+#if !defined(__EMSCRIPTEN__)
+#include <atomic>
+#include <thread>
+#endif
 
 // The solver will converge all unknowns to within this tolerance. This must
 // always be much less than LENGTH_EPS, and in practice should be much less.
 const double System::CONVERGE_TOLERANCE = (LENGTH_EPS/(1e2));
+// A basis vector of a null space with a component smaller than this along
+// some row or column is taken to have none.
+const double System::RANK_TOLERANCE = 1e-8;
 
 constexpr size_t LikelyPartialCountPerEq = 10;
 
-bool System::WriteJacobian(int tag) {
+// The matrices for the dense solves; they're small, so they live on the stack.
+typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, 0,
+                      System::DENSE_SIZE, System::DENSE_SIZE> DenseMatrix;
+typedef Eigen::Matrix<double, Eigen::Dynamic, 1, 0,
+                      System::DENSE_SIZE, 1> DenseVector;
+
+//-----------------------------------------------------------------------------
+// Everything about the Jacobian that depends only on the form of the
+// equations, and not on the values of the unknowns: the compiled tape, where
+// each entry of A and B is found in it, and the ordering that the least
+// squares solve chose for A*A^T. While dragging, only the values change, so
+// these are kept across solves.
+//-----------------------------------------------------------------------------
+struct System::JacobianForm {
+    // What the form was compiled from; see WriteJacobianKey()
+    std::vector<uint64_t>   key;
+
+    // The residuals and (unless in reverse mode) the partials
+    ExprTape                tape;
+    // The tape register of each equation
+    std::vector<int>        residual;
+    // Each entry of A that is not identically zero, in column order, and
+    // the tape register of its partial derivative
+    struct Partial {
+        int row, col, reg;
+    };
+    std::vector<Partial>    partial;
+
+    // In reverse mode, for each row instead, the instructions that its
+    // equation depends on, and the register and column of each unknown
+    struct Row {
+        std::vector<int>                    deps;
+        std::vector<std::pair<int, int>>    unknowns;
+    };
+    std::vector<Row>        rows;
+    std::vector<double>     adj;
+
+    // The parameter that each PARAM_PTR instruction loads, so that the tape
+    // can be pointed at the parameters of a later solve
+    std::vector<std::pair<int, hParam>> loads;
+
+    // The factorization of A*A^T, and the pattern that it was analyzed for
+    Eigen::SparseQR<Eigen::SparseMatrix<double>, Eigen::COLAMDOrdering<int>> qr;
+    std::vector<int>        qrOuter, qrInner;
+
+    size_t Size() const { return key.size() + tape.code.size() + partial.size(); }
+
+    bool SolveLinearSystem(const Eigen::SparseMatrix<double> &A,
+                           const Eigen::VectorXd &B, Eigen::VectorXd *X);
+};
+
+// The forms that have been compiled, by key; the least recently used ones
+// are dropped once they get too big in total.
+class System::JacobianCache {
+public:
+    enum { MAX_SIZE = 1 << 22 };
+
+    std::shared_ptr<JacobianForm> Find(const std::vector<uint64_t> &key) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = forms.find(key);
+        if(it == forms.end()) return NULL;
+        // Move it to the front, most recently used.
+        lru.splice(lru.begin(), lru, it->second);
+        return *it->second;
+    }
+
+    void Add(std::shared_ptr<JacobianForm> form) {
+        std::lock_guard<std::mutex> lock(mutex);
+        // Two threads may have compiled the same form at once; keep the newer.
+        auto it = forms.find(form->key);
+        if(it != forms.end()) {
+            size -= (*it->second)->Size();
+            lru.erase(it->second);
+            forms.erase(it);
+        }
+        size += form->Size();
+        while(size > MAX_SIZE && !lru.empty()) {
+            const std::shared_ptr<JacobianForm> &oldest = lru.back();
+            size -= oldest->Size();
+            forms.erase(oldest->key);
+            lru.pop_back();
+        }
+        lru.push_front(form);
+        forms[form->key] = lru.begin();
+    }
+
+private:
+    struct KeyHash {
+        size_t operator()(const std::vector<uint64_t> &key) const {
+            uint64_t h = 14695981039346656037ull;
+            for(uint64_t k : key) {
+                h = (h ^ k) * 1099511628211ull;
+            }
+            return (size_t)h;
+        }
+    };
+    typedef std::list<std::shared_ptr<JacobianForm>> FormList;
+
+    std::mutex mutex;
+    // Most recently used first
+    FormList lru;
+    std::unordered_map<std::vector<uint64_t>, FormList::iterator, KeyHash> forms;
+    size_t size = 0;
+};
+
+static void WriteExprKey(const Expr *e, std::vector<uint64_t> *key) {
+    switch(e->op) {
+        case Expr::Op::PARAM:
+        case Expr::Op::PARAM_PTR: {
+            // Known parameters are loaded from their Params too, like the
+            // unknowns, so only the handle is part of the form; which ones
+            // are unknown is in the key already, as the columns.
+            hParam hp = (e->op == Expr::Op::PARAM) ? e->parh : e->parp->h;
+            key->push_back((uint64_t)Expr::Op::PARAM);
+            key->push_back(hp.v);
+            return;
+        }
+
+        case Expr::Op::CONSTANT: {
+            uint64_t v;
+            memcpy(&v, &e->v, sizeof(v));
+            key->push_back((uint64_t)e->op);
+            key->push_back(v);
+            return;
+        }
+
+        case Expr::Op::VARIABLE: ssassert(false, "Not supported yet");
+
+        default:
+            key->push_back((uint64_t)e->op);
+            int c = e->Children();
+            if(c > 0) WriteExprKey(e->a, key);
+            if(c > 1) WriteExprKey(e->b, key);
+            return;
+    }
+}
+
+void System::WriteJacobianKey(std::vector<uint64_t> *key) {
+    key->push_back((uint64_t)differentiation);
+    key->push_back(mat.param.size());
+    for(hParam hp : mat.param) {
+        key->push_back(hp.v);
+    }
+    key->push_back(mat.eq.size());
+    for(Equation *e : mat.eq) {
+        WriteExprKey(e->e, key);
+    }
+}
+
+bool System::WriteJacobian(int tag, bool useCache) {
     // Clear all
     mat.param.clear();
     mat.eq.clear();
     mat.A.sym.setZero();
     mat.B.sym.clear();
 
+    mat.paramp.clear();
     for(Param &p : param) {
         if(p.tag != tag) continue;
         mat.param.push_back(p.h);
+        mat.paramp.push_back(&p);
     }
     mat.n = mat.param.size();
 
@@ -35,38 +198,95 @@ bool System::WriteJacobian(int tag) {
         mat.eq.push_back(&e);
     }
     mat.m = mat.eq.size();
-    mat.A.sym.resize(mat.m, mat.n);
-    mat.A.sym.reserve(Eigen::VectorXi::Constant(mat.n, LikelyPartialCountPerEq));
-
-    // Fill the param id to index map
-    std::map<uint32_t, int> paramToIndex;
-    for(int j = 0; j < mat.n; j++) {
-        paramToIndex[mat.param[j].v] = j;
-    }
 
     if(mat.eq.size() >= MAX_UNKNOWNS) {
         return false;
     }
+
+    // Scale the columns; this scale weights the parameters for the least
+    // squares solve, so that we can encourage the solver to make bigger
+    // changes in some parameters, and smaller in others.
+    mat.val.resize(mat.n);
+    mat.scale = Eigen::VectorXd::Ones(mat.n);
+    for(int c = 0; c < mat.n; c++) {
+        mat.val[c] = mat.paramp[c]->val;
+        if(IsDragged(mat.param[c])) {
+            // It's least squares, so this parameter doesn't need to be all
+            // that big to get a large effect.
+            mat.scale[c] = 1 / 20.0;
+        }
+    }
+
+    std::vector<uint64_t> key;
+    mat.form = NULL;
+    if(useCache) {
+        if(!jacobianCache) jacobianCache = std::make_shared<JacobianCache>();
+        WriteJacobianKey(&key);
+        mat.form = jacobianCache->Find(key);
+    }
+    if(!mat.form) {
+        mat.form = std::make_shared<JacobianForm>();
+        CompileJacobian();
+        if(useCache) {
+            mat.form->key = std::move(key);
+            jacobianCache->Add(mat.form);
+        }
+    }
+
+    // Point the loads of the unknowns at mat.val, and the rest at their
+    // parameters; a cached form may have been compiled for other copies.
+    for(const auto &load : mat.form->loads) {
+        ExprTape::Instr *in = &mat.form->tape.code[load.first];
+        int j = ColumnOf(load.second);
+        if(j >= 0) {
+            in->parp = mat.paramp[j];
+            in->src  = &mat.val[j];
+        } else {
+            Param *p = param.FindByIdNoOops(load.second);
+            if(!p) p = SK.param.FindById(load.second);
+            in->parp = p;
+            in->src  = &p->val;
+        }
+    }
+    return true;
+}
+
+int System::ColumnOf(hParam hp) const {
+    // The columns are in the order of the param list, so by handle.
+    auto it = std::lower_bound(mat.param.begin(), mat.param.end(), hp,
+                               [](hParam a, hParam b) { return a.v < b.v; });
+    if(it == mat.param.end() || it->v != hp.v) return -1;
+    return (int)(it - mat.param.begin());
+}
+
+void System::CompileJacobian() {
+    JacobianForm *form = mat.form.get();
+    mat.A.sym.resize(mat.m, mat.n);
+    mat.A.sym.reserve(Eigen::VectorXi::Constant(mat.n, LikelyPartialCountPerEq));
+
     std::vector<hParam> paramsUsed;
     // In some experimenting, this is almost always the right size.
     // Value is usually between 0 and 20, comes from number of constraints?
     mat.B.sym.reserve(mat.eq.size());
     for(size_t i = 0; i < mat.eq.size(); i++) {
         Equation *e = mat.eq[i];
-        if(e->tag != tag) continue;
         // Simplify (fold) then deep-copy the current equation.
         Expr *f = e->e->FoldConstants();
         f = f->DeepCopyWithParamsAsPointers(&param, &(SK.param));
 
+        if(differentiation == Differentiation::REVERSE_MODE) {
+            // The partials are found from the tape, below.
+            mat.B.sym.push_back(f);
+            continue;
+        }
+
         paramsUsed.clear();
         f->ParamsUsedList(&paramsUsed);
 
         for(hParam &p : paramsUsed) {
             // Find the index of this parameter
-            auto it = paramToIndex.find(p.v);
-            if(it == paramToIndex.end()) continue;
-            // this is the parameter index
-            const int j = it->second;
+            const int j = ColumnOf(p);
+            if(j < 0) continue;
             // compute partial derivative of f
             Expr *pd = f->PartialWrt(p);
             pd = pd->FoldConstants();
@@ -77,21 +297,88 @@ bool System::WriteJacobian(int tag) {
         paramsUsed.clear();
         mat.B.sym.push_back(f);
     }
-    return true;
+
+    // Compile the residuals and the partials into one tape, so that the
+    // subexpressions that they share are only evaluated once.
+    for(Expr *f : mat.B.sym) {
+        form->residual.push_back(form->tape.Compile(f));
+    }
+    for(int k = 0; k < mat.A.sym.outerSize(); k++) {
+        for(Eigen::SparseMatrix<Expr *>::InnerIterator it(mat.A.sym, k); it; ++it) {
+            JacobianForm::Partial pd = {};
+            pd.row = (int)it.row();
+            pd.col = (int)it.col();
+            pd.reg = form->tape.Compile(it.value());
+            form->partial.push_back(pd);
+        }
+    }
+
+    if(differentiation == Differentiation::REVERSE_MODE) {
+        form->rows.resize(mat.m);
+        for(int i = 0; i < mat.m; i++) {
+            auto &row = form->rows[i];
+            form->tape.Dependencies(form->residual[i], &row.deps);
+            for(int k : row.deps) {
+                const ExprTape::Instr &in = form->tape.code[k];
+                if(in.op != Expr::Op::PARAM_PTR) continue;
+                int j = ColumnOf(in.parp->h);
+                if(j < 0) continue;
+                row.unknowns.emplace_back(in.dest, j);
+            }
+        }
+        form->adj.assign(form->tape.reg.size(), 0.0);
+    }
+
+    for(size_t k = 0; k < form->tape.code.size(); k++) {
+        const ExprTape::Instr &in = form->tape.code[k];
+        if(in.op != Expr::Op::PARAM_PTR) continue;
+        form->loads.emplace_back((int)k, in.parp->h);
+    }
 }
 
+//-----------------------------------------------------------------------------
+// Evaluate the functions and the Jacobian at our operating point, in one
+// pass over the tape.
+//-----------------------------------------------------------------------------
 void System::EvalJacobian() {
     using namespace Eigen;
+    JacobianForm *form = mat.form.get();
+    form->tape.Eval();
+
+    mat.B.num.resize(mat.m);
+    for(int i = 0; i < mat.m; i++) {
+        mat.B.num[i] = form->tape.Value(form->residual[i]);
+    }
+
     mat.A.num.setZero();
     mat.A.num.resize(mat.m, mat.n);
-    const int size = mat.A.sym.outerSize();
-
-    for(int k = 0; k < size; k++) {
-        for(SparseMatrix <Expr *>::InnerIterator it(mat.A.sym, k); it; ++it) {
-            double value = it.value()->Eval();
-            if(EXACT(value == 0.0)) continue;
-            mat.A.num.insert(it.row(), it.col()) = value;
+    if(differentiation == Differentiation::REVERSE_MODE) {
+        // One reverse sweep per row gives all of that row's partials.
+        std::vector<Triplet<double>> entries;
+        double *adj = form->adj.data();
+        for(int i = 0; i < mat.m; i++) {
+            const auto &row = form->rows[i];
+            for(int k : row.deps) {
+                const ExprTape::Instr &in = form->tape.code[k];
+                adj[in.dest] = 0.0;
+                adj[in.a] = 0.0;
+                adj[in.b] = 0.0;
+            }
+            form->tape.Backprop(form->residual[i], row.deps, adj);
+            for(const auto &u : row.unknowns) {
+                double value = adj[u.first];
+                if(EXACT(value == 0.0)) continue;
+                entries.emplace_back(i, u.second, value);
+            }
         }
+        mat.A.num.setFromTriplets(entries.begin(), entries.end());
+        return;
+    }
+
+    for(const JacobianForm::Partial &pd : form->partial) {
+        double value = form->tape.Value(pd.reg);
+        if(EXACT(value == 0.0)) continue;
+        mat.A.num.insert(pd.row, pd.col) = value;
     }
     mat.A.num.makeCompressed();
 }
@@ -217,12 +504,199 @@ void System::SolveBySubstitution() {
     }
 }
 
+//-----------------------------------------------------------------------------
+// Split the equations and parameters that are still untagged into connected
+// components, where two equations are connected if they share a parameter.
+// Each component gets its own tag, starting from firstTag, so that it can be
+// solved without the others. Any equations that reference no unknowns, and
+// any unknowns that appear in no equation, are lumped into one more component.
+//-----------------------------------------------------------------------------
+void System::FindComponents(int firstTag) {
+    std::map<uint32_t, int> paramToIndex;
+    std::vector<Param *> params;
+    for(Param &p : param) {
+        if(p.tag != 0) continue;
+        paramToIndex[p.h.v] = (int)params.size();
+        params.push_back(&p);
+    }
+
+    // A union-find forest over the parameters; path halving keeps it flat.
+    std::vector<int> parent(params.size());
+    for(size_t i = 0; i < parent.size(); i++) {
+        parent[i] = (int)i;
+    }
+    auto findRoot = [&](int i) {
+        while(parent[i] != i) {
+            parent[i] = parent[parent[i]];
+            i = parent[i];
+        }
+        return i;
+    };
+
+    // For each equation, remember one of its parameters (or -1 if none).
+    std::vector<std::pair<Equation *, int>> eqs;
+    std::vector<hParam> paramsUsed;
+    for(Equation &e : eq) {
+        if(e.tag != 0) continue;
+
+        paramsUsed.clear();
+        e.e->ParamsUsedList(&paramsUsed);
+
+        int first = -1;
+        for(hParam &hp : paramsUsed) {
+            auto it = paramToIndex.find(hp.v);
+            if(it == paramToIndex.end()) continue;
+            if(first < 0) {
+                first = it->second;
+                continue;
+            }
+            int ra = findRoot(first),
+                rb = findRoot(it->second);
+            if(ra != rb) parent[rb] = ra;
+        }
+        eqs.emplace_back(&e, first);
+    }
+
+    std::vector<bool> hasEquations(params.size(), false);
+    for(auto &ep : eqs) {
+        if(ep.second < 0) continue;
+        hasEquations[findRoot(ep.second)] = true;
+    }
+
+    // Number the components in order of their first parameter, so that the
+    // result doesn't depend on anything but the order of the lists.
+    int nextTag = firstTag;
+    int looseTag = 0;
+    std::vector<int> rootTag(params.size(), 0);
+    for(size_t i = 0; i < params.size(); i++) {
+        int root = findRoot((int)i);
+        if(!hasEquations[root]) {
+            if(looseTag == 0) looseTag = nextTag++;
+            params[i]->tag = looseTag;
+            continue;
+        }
+        if(rootTag[root] == 0) rootTag[root] = nextTag++;
+        params[i]->tag = rootTag[root];
+    }
+    for(auto &ep : eqs) {
+        if(ep.second < 0) {
+            if(looseTag == 0) looseTag = nextTag++;
+            ep.first->tag = looseTag;
+        } else {
+            ep.first->tag = rootTag[findRoot(ep.second)];
+        }
+    }
+
+    firstComponent = firstTag;
+    components     = nextTag - firstTag;
+}
+
+bool System::IsComponentTag(int tag) const {
+    return tag >= firstComponent && tag < firstComponent + components;
+}
+
+bool System::IsDense() const {
+    return !sparseOnly && mat.m <= DENSE_SIZE && mat.n <= DENSE_SIZE;
+}
+
+//-----------------------------------------------------------------------------
+// A column pivoted QR of a small dense matrix. Its rank is found with the
+// same threshold that SparseQR uses by default: the largest column norm,
+// which is the first pivot, times 20*(rows + cols)*epsilon.
+//-----------------------------------------------------------------------------
+static Eigen::ColPivHouseholderQR<DenseMatrix> DenseQR(const DenseMatrix &A) {
+    Eigen::ColPivHouseholderQR<DenseMatrix> qr(A.rows(), A.cols());
+    qr.setThreshold(20.0 * (A.rows() + A.cols()) * Eigen::NumTraits<double>::epsilon());
+    qr.compute(A);
+    return qr;
+}
+
+static DenseMatrix ToDense(const Eigen::SparseMatrix<double> &A) {
+    DenseMatrix D = DenseMatrix::Zero(A.rows(), A.cols());
+    for(int k = 0; k < A.outerSize(); k++) {
+        for(Eigen::SparseMatrix<double>::InnerIterator it(A, k); it; ++it) {
+            D(it.row(), it.col()) = it.value();
+        }
+    }
+    return D;
+}
+
+// Like SparseQR, this drops the pivots past the rank, and so finds a basic
+// solution if A is singular.
+static void SolveDense(const DenseMatrix &A, const DenseVector &B, Eigen::VectorXd *X) {
+    using namespace Eigen;
+    ColPivHouseholderQR<DenseMatrix> qr = DenseQR(A);
+    const int rank = (int)qr.rank();
+    DenseVector c = qr.householderQ().adjoint() * B;
+    DenseVector y = DenseVector::Zero(A.cols());
+    y.head(rank) = qr.matrixQR().topLeftCorner(rank, rank)
+                       .triangularView<Upper>().solve(c.head(rank));
+    *X = qr.colsPermutation() * y;
+}
+
+// The Householder reflections mix every row that they touch, so rows that
+// aren't coupled would pick up each other's rounding error, and a param that
+// should stay exactly where it is would move by 1e-48 or so. The sparse QR
+// only touches the rows in each reflector's pattern, so it doesn't do that;
+// to match, solve each block of rows coupled through the symmetric matrix A
+// on its own.
+static void SolveDenseBlocks(const DenseMatrix &A, const DenseVector &B, Eigen::VectorXd *X) {
+    const int n = (int)A.rows();
+    int block[System::DENSE_SIZE];
+    std::fill(block, block + n, -1);
+    int blocks = 0;
+    for(int i = 0; i < n; i++) {
+        if(block[i] >= 0) continue;
+        int stack[System::DENSE_SIZE], top = 0;
+        block[i] = blocks;
+        stack[top++] = i;
+        while(top > 0) {
+            int r = stack[--top];
+            for(int c = 0; c < n; c++) {
+                if(block[c] < 0 && !EXACT(A(r, c) == 0.0)) {
+                    block[c] = blocks;
+                    stack[top++] = c;
+                }
+            }
+        }
+        blocks++;
+    }
+    if(blocks == 1) {
+        SolveDense(A, B, X);
+        return;
+    }
+
+    *X = Eigen::VectorXd::Zero(n);
+    for(int b = 0; b < blocks; b++) {
+        int rows[System::DENSE_SIZE], k = 0;
+        for(int i = 0; i < n; i++) {
+            if(block[i] == b) rows[k++] = i;
+        }
+        DenseMatrix Ab(k, k);
+        DenseVector Bb(k);
+        for(int i = 0; i < k; i++) {
+            Bb(i) = B(rows[i]);
+            for(int j = 0; j < k; j++) {
+                Ab(i, j) = A(rows[i], rows[j]);
+            }
+        }
+        Eigen::VectorXd Xb;
+        SolveDense(Ab, Bb, &Xb);
+        for(int i = 0; i < k; i++) {
+            (*X)(rows[i]) = Xb(i);
+        }
+    }
+}
+
 //-----------------------------------------------------------------------------
 // Calculate the rank of the Jacobian matrix
 //-----------------------------------------------------------------------------
 int System::CalculateRank() {
     using namespace Eigen;
     if(mat.n == 0 || mat.m == 0) return 0;
+    if(IsDense()) {
+        return DenseQR(ToDense(mat.A.num)).rank();
+    }
     SparseQR <SparseMatrix<double>, COLAMDOrdering<int>> solver;
     solver.compute(mat.A.num);
     int result = solver.rank();
@@ -238,32 +712,30 @@ bool System::TestRank(int *dof) {
     return jacobianRank == mat.m;
 }
 
-bool System::SolveLinearSystem(const Eigen::SparseMatrix <double> &A,
-                               const Eigen::VectorXd &B, Eigen::VectorXd *X)
+bool System::JacobianForm::SolveLinearSystem(const Eigen::SparseMatrix<double> &A,
+                                             const Eigen::VectorXd &B, Eigen::VectorXd *X)
 {
     if(A.outerSize() == 0) return true;
-    using namespace Eigen;
-    SparseQR<SparseMatrix<double>, COLAMDOrdering<int>> solver;
-    //SimplicialLDLT<SparseMatrix<double>> solver;
-    solver.compute(A);
-    *X = solver.solve(B);
-    return (solver.info() == Success);
+    // The fill-reducing ordering depends only on where the nonzeros are, so
+    // it's found again only if those have moved.
+    const int *outer = A.outerIndexPtr(), *inner = A.innerIndexPtr();
+    if(qrOuter.size() != (size_t)A.outerSize() + 1 ||
+       qrInner.size() != (size_t)A.nonZeros() ||
+       !std::equal(qrOuter.begin(), qrOuter.end(), outer) ||
+       !std::equal(qrInner.begin(), qrInner.end(), inner))
+    {
+        qr.analyzePattern(A);
+        qrOuter.assign(outer, outer + A.outerSize() + 1);
+        qrInner.assign(inner, inner + A.nonZeros());
+    }
+    qr.factorize(A);
+    *X = qr.solve(B);
+    return (qr.info() == Eigen::Success);
 }
 
-bool System::SolveLeastSquares() {
+bool System::SolveLeastSquares(double damping) {
     using namespace Eigen;
-    // Scale the columns; this scale weights the parameters for the least
-    // squares solve, so that we can encourage the solver to make bigger
-    // changes in some parameters, and smaller in others.
-    mat.scale = VectorXd::Ones(mat.n);
-    for(int c = 0; c < mat.n; c++) {
-        if(IsDragged(mat.param[c])) {
-            // It's least squares, so this parameter doesn't need to be all
-            // that big to get a large effect.
-            mat.scale[c] = 1 / 20.0;
-        }
-    }
-
+    // Scale the columns, as set up by WriteJacobian().
     const int size = mat.A.num.outerSize();
     for(int k = 0; k < size; k++) {
         for(SparseMatrix<double>::InnerIterator it(mat.A.num, k); it; ++it) {
@@ -271,11 +743,27 @@ bool System::SolveLeastSquares() {
         }
     }
 
+    if(IsDense()) {
+        DenseMatrix A = ToDense(mat.A.num);
+        DenseMatrix AAt = A * A.transpose();
+        AAt.diagonal().array() += damping;
+        VectorXd z;
+        SolveDenseBlocks(AAt, mat.B.num, &z);
+        mat.X = (A.transpose() * z).cwiseProduct(mat.scale);
+        return true;
+    }
+
     SparseMatrix<double> AAt = mat.A.num * mat.A.num.transpose();
+    if(damping > 0.0) {
+        // Then this is the step that minimizes |AX - B|^2 + damping*|X|^2.
+        SparseMatrix<double> I(mat.m, mat.m);
+        I.setIdentity();
+        AAt += damping * I;
+    }
     AAt.makeCompressed();
     VectorXd z(mat.n);
 
-    if(!SolveLinearSystem(AAt, mat.B.num, &z)) return false;
+    if(!mat.form->SolveLinearSystem(AAt, mat.B.num, &z)) return false;
 
     mat.X = mat.A.num.transpose() * z;
 
@@ -285,38 +773,56 @@ bool System::SolveLeastSquares() {
     return true;
 }
 
+double System::LargestResidual() const {
+    double largest = 0.0;
+    for(int i = 0; i < mat.m; i++) {
+        largest = max(largest, fabs(mat.B.num[i]));
+    }
+    return largest;
+}
+
+//-----------------------------------------------------------------------------
+// Solve the system written by WriteJacobian(). The steps work on mat.val,
+// which the tape loads the unknowns from, so the params themselves are only
+// read here, and written once at the end.
+//-----------------------------------------------------------------------------
 bool System::NewtonSolve(int tag) {
+    for(int i = 0; i < mat.n; i++) {
+        mat.val[i] = mat.paramp[i]->val;
+    }
+    bool converged = (method == Method::LEVENBERG_MARQUARDT) ?
+                     DampedNewtonSteps() : NewtonSteps();
+    for(int i = 0; i < mat.n; i++) {
+        mat.paramp[i]->val = mat.val[i];
+    }
+    return converged;
+}
 
+bool System::NewtonSteps() {
     int iter = 0;
     bool converged = false;
     int i;
 
-    // Evaluate the functions at our operating point.
-    mat.B.num = Eigen::VectorXd(mat.m);
-    for(i = 0; i < mat.m; i++) {
-        mat.B.num[i] = (mat.B.sym[i])->Eval();
-    }
+    // Evaluate the functions and the Jacobian at our operating point.
+    EvalJacobian();
     do {
-        // And evaluate the Jacobian at our initial operating point.
-        EvalJacobian();
-
         if(!SolveLeastSquares()) break;
 
         // Take the Newton step;
         //      J(x_n) (x_{n+1} - x_n) = 0 - F(x_n)
+        mat.val -= mat.X;
         for(i = 0; i < mat.n; i++) {
-            Param *p = param.FindById(mat.param[i]);
-            p->val -= mat.X[i];
-            if(IsReasonable(p->val)) {
+            if(IsReasonable(mat.val[i])) {
                 // Very bad, and clearly not convergent
                 return false;
             }
         }
 
-        // Re-evalute the functions, since the params have just changed.
-        for(i = 0; i < mat.m; i++) {
-            mat.B.num[i] = (mat.B.sym[i])->Eval();
-        }
+        // Re-evalute the functions and the Jacobian, since the params have
+        // just changed.
+        EvalJacobian();
+        stats.iterations++;
+        stats.residual.push_back(LargestResidual());
         // Check for convergence
         converged = true;
         for(i = 0; i < mat.m; i++) {
@@ -333,6 +839,92 @@ bool System::NewtonSolve(int tag) {
     return converged;
 }
 
+//-----------------------------------------------------------------------------
+// Like NewtonSteps(), but only steps that reduce the sum of squared residuals
+// get taken. If the full step doesn't, then we search back along it, and
+// failing that, take the step back and try again with Levenberg-Marquardt
+// damping. The damping is adapted as Nielsen does, going down as the linear
+// model proves good, and off once it's negligible; so while Newton's method
+// works, this is exactly that, and where it doesn't (far from the solution,
+// or at a singular Jacobian), it falls back toward steepest descent.
+//-----------------------------------------------------------------------------
+bool System::DampedNewtonSteps() {
+    using namespace Eigen;
+
+    EvalJacobian();
+    double cost = mat.B.num.squaredNorm();
+    if(LargestResidual() <= CONVERGE_TOLERANCE) return true;
+
+    // The damping is measured against the rows of the Jacobian.
+    double largestRow = 0.0;
+    VectorXd rowNorm = VectorXd::Zero(mat.m);
+    for(int k = 0; k < mat.A.num.outerSize(); k++) {
+        for(SparseMatrix<double>::InnerIterator it(mat.A.num, k); it; ++it) {
+            rowNorm[it.row()] += it.value() * it.value();
+        }
+    }
+    if(mat.m > 0) largestRow = rowNorm.maxCoeff();
+    largestRow = max(largestRow, 1e-12);
+    double damping = 0.0;
+    double growth = 2.0;
+
+    for(int iter = 0; iter < 50; iter++) {
+        // Keep what we need to take the step back.
+        SparseMatrix<double> A = mat.A.num;
+        VectorXd B = mat.B.num;
+        VectorXd start = mat.val;
+
+        if(!SolveLeastSquares(damping)) break;
+        stats.iterations++;
+        // What the linear model says the step changes the residuals by; A.num
+        // has the columns scaled now, so unscale the step to match.
+        VectorXd change = mat.A.num * mat.X.cwiseQuotient(mat.scale);
+
+        bool accepted = false;
+        double gain = 0.0;
+        for(double t = 1.0; t >= 1.0 / 8; t /= 2) {
+            bool reasonable = true;
+            mat.val = start - t * mat.X;
+            for(int i = 0; i < mat.n; i++) {
+                if(IsReasonable(mat.val[i])) reasonable = false;
+            }
+            if(!reasonable) continue;
+            EvalJacobian();
+            for(int i = 0; i < mat.m; i++) {
+                if(IsReasonable(mat.B.num[i])) reasonable = false;
+            }
+            if(!reasonable) continue;
+
+            double newCost = mat.B.num.squaredNorm();
+            double predictedGain = cost - (B - t * change).squaredNorm();
+            if(newCost < cost && predictedGain > 0.0) {
+                gain = (cost - newCost) / predictedGain;
+                cost = newCost;
+                accepted = true;
+                break;
+            }
+        }
+
+        if(accepted) {
+            stats.residual.push_back(LargestResidual());
+            if(LargestResidual() <= CONVERGE_TOLERANCE) return true;
+            damping *= max(1.0 / 3.0, 1.0 - pow(2.0 * gain - 1.0, 3));
+            if(damping < 1e-9 * largestRow) damping = 0.0;
+            growth = 2.0;
+        } else {
+            mat.val = start;
+            mat.A.num = A;
+            mat.B.num = B;
+            stats.residual.push_back(LargestResidual());
+            damping = (damping > 0.0) ? damping * growth : 1e-3 * largestRow;
+            growth *= 2.0;
+            // By now the steps would be too small to matter.
+            if(damping > 1e12 * largestRow) break;
+        }
+    }
+    return false;
+}
+
 void System::WriteEquationsExceptFor(hConstraint hc, Group *g) {
     // Generate all the equations from constraints in this group
     for(auto &con : SK.constraint) {
@@ -368,12 +960,169 @@ void System::WriteEquationsExceptFor(hConstraint hc, Group *g) {
     g->GenerateEquations(&eq);
 }
 
+//-----------------------------------------------------------------------------
+// Find an orthonormal basis for the part of the space that the columns of A
+// don't span, from a single factorization; returns the rank of A. The basis
+// is dense, so this is for when that part is small, like the redundancy of
+// an almost fully constrained sketch.
+//-----------------------------------------------------------------------------
+static int FindComplementOfRange(const Eigen::SparseMatrix<double> &A, Eigen::MatrixXd *C) {
+    using namespace Eigen;
+    const int rows = (int)A.rows();
+    if(A.cols() == 0) {
+        *C = MatrixXd::Identity(rows, rows);
+        return 0;
+    }
+    SparseQR<SparseMatrix<double>, COLAMDOrdering<int>> solver;
+    solver.compute(A);
+    // The first rank columns of Q span the range, and the rest are
+    // orthogonal to it.
+    int rank = (int)solver.rank();
+    MatrixXd E = MatrixXd::Zero(rows, rows - rank);
+    E.bottomRows(rows - rank).setIdentity();
+    *C = solver.matrixQ() * E;
+    return rank;
+}
+
+//-----------------------------------------------------------------------------
+// For each row of A, how far the unit vector along it is from the space that
+// the columns of A span; that's the norm of that row of the basis found by
+// FindComplementOfRange(). That basis can be big when A has many more rows
+// than rank, so instead Q is applied to a few unit vectors at a time.
+//-----------------------------------------------------------------------------
+static void FindDistancesFromRange(const Eigen::SparseMatrix<double> &A,
+                                   std::vector<double> *dist)
+{
+    using namespace Eigen;
+    const int rows = (int)A.rows();
+    if(A.cols() == 0) {
+        dist->assign(rows, 1.0);
+        return;
+    }
+    SparseQR<SparseMatrix<double>, COLAMDOrdering<int>> solver;
+    solver.compute(A);
+    const int rank = (int)solver.rank();
+    const int BLOCK = 32;
+
+    dist->resize(rows);
+    MatrixXd E, QtE;
+    for(int start = 0; start < rows; start += BLOCK) {
+        int count = std::min(BLOCK, rows - start);
+        E = MatrixXd::Zero(rows, count);
+        E.middleRows(start, count).setIdentity();
+        QtE = solver.matrixQ().transpose() * E;
+        for(int k = 0; k < count; k++) {
+            (*dist)[start + k] = QtE.col(k).tail(rows - rank).norm();
+        }
+    }
+}
+
+static int FindRoot(std::vector<int> *parent, int i) {
+    while((*parent)[i] != i) {
+        (*parent)[i] = (*parent)[(*parent)[i]];
+        i = (*parent)[i];
+    }
+    return i;
+}
+
 void System::FindWhichToRemoveToFixJacobian(Group *g, List<hConstraint> *bad, bool forceDofCheck) {
+    using namespace Eigen;
     auto time = GetMilliseconds();
     g->solved.timeout = false;
-    int a;
 
-    for(a = 0; a < 2; a++) {
+    // Write the whole system again, so that each constraint has all of its
+    // equations, and evaluate it where the solver left it.
+    eq.Clear();
+    WriteEquationsExceptFor(Constraint::NO_CONSTRAINT, g);
+    eq.ClearTags();
+    std::vector<int> paramTags;
+    std::map<uint32_t, int> paramIndex;
+    for(Param &p : param) {
+        if(p.tag == VAR_SUBSTITUTED) p.val = p.substd->val;
+        paramIndex[p.h.v] = (int)paramTags.size();
+        paramTags.push_back(p.tag);
+    }
+    const int n = (int)paramTags.size();
+
+    // Unless we were asked not to, the system got solved with the equations
+    // of the form a - b = 0 substituted out, and the rank test saw only the
+    // dependencies that are left after that. So do the same: instead of
+    // writing those rows, merge the columns of the parameters that they
+    // connect. Here, an edge is such an equation.
+    std::vector<std::pair<int, int>> edges;
+    std::map<uint32_t, std::vector<int>> edgesOf;
+    if(!forceDofCheck) {
+        for(Equation &e : eq) {
+            Expr *ex = e.e;
+            if(ex->op != Expr::Op::MINUS || ex->a->op != Expr::Op::PARAM ||
+               ex->b->op != Expr::Op::PARAM) continue;
+            auto ia = paramIndex.find(ex->a->parh.v),
+                 ib = paramIndex.find(ex->b->parh.v);
+            if(ia == paramIndex.end() || ib == paramIndex.end()) continue;
+
+            e.tag = EQ_SUBSTITUTED;
+            if(e.h.isFromConstraint()) {
+                edgesOf[e.h.constraint().v].push_back((int)edges.size());
+            }
+            edges.emplace_back(ia->second, ib->second);
+        }
+    }
+    std::vector<int> root(n);
+    for(int j = 0; j < n; j++) root[j] = j;
+    for(const auto &edge : edges) {
+        root[FindRoot(&root, edge.first)] = FindRoot(&root, edge.second);
+    }
+    // The merged column of each parameter, and the parameters in each
+    std::vector<int> column(n, -1);
+    std::vector<std::vector<int>> members;
+    std::vector<Triplet<double>> merge;
+    for(int j = 0; j < n; j++) {
+        int r = FindRoot(&root, j);
+        if(column[r] < 0) {
+            column[r] = (int)members.size();
+            members.emplace_back();
+        }
+        column[j] = column[r];
+        members[column[j]].push_back(j);
+        merge.emplace_back(j, column[j], 1.0);
+    }
+    const int merged = (int)members.size();
+
+    for(Param &p : param) {
+        p.tag = 0;
+    }
+    bool written = WriteJacobian(0);
+    if(written) EvalJacobian();
+    int k = 0;
+    for(Param &p : param) {
+        p.tag = paramTags[k++];
+    }
+    if(!written) return;
+
+    SparseMatrix<double> M(n, merged);
+    M.setFromTriplets(merge.begin(), merge.end());
+    SparseMatrix<double> J = mat.A.num * M;
+
+    // Removing a constraint makes the rest full rank exactly when every
+    // dependency between the rows involves its equations, i.e. when its rows
+    // of a basis for the left null space have full rank themselves. So one
+    // factorization of the Jacobian answers that for every constraint.
+    MatrixXd leftNull;
+    FindComplementOfRange(J, &leftNull);
+    const int redundancy = (int)leftNull.cols();
+    if(redundancy == 0) return;
+
+    std::map<uint32_t, std::vector<int>> rowsOf;
+    for(int i = 0; i < mat.m; i++) {
+        hEquation he = mat.eq[i]->h;
+        if(!he.isFromConstraint()) continue;
+        rowsOf[he.constraint().v].push_back(i);
+    }
+    // Each parameter's own column, against the left null space
+    MatrixXd W;
+    if(!edges.empty()) W = mat.A.num.transpose() * leftNull;
+
+    for(int a = 0; a < 2; a++) {
         for(auto &con : SK.constraint) {
             if((GetMilliseconds() - time) > g->solved.findToFixTimeout) {
                 g->solved.timeout = true;
@@ -391,22 +1140,61 @@ void System::FindWhichToRemoveToFixJacobian(Group *g, List<hConstraint> *bad, bo
                 continue;
             }
 
-            param.ClearTags();
-            eq.Clear();
-            WriteEquationsExceptFor(c->h, g);
-            eq.ClearTags();
-
-            // It's a major speedup to solve the easy ones by substitution here,
-            // and that doesn't break anything.
-            if(!forceDofCheck) {
-                SolveBySubstitution();
+            std::vector<RowVectorXd> conditions;
+            auto rows = rowsOf.find(c->h.v);
+            if(rows != rowsOf.end()) {
+                for(int i : rows->second) {
+                    conditions.push_back(leftNull.row(i));
+                }
             }
 
-            WriteJacobian(0);
-            EvalJacobian();
+            // Without this constraint's substitutions, the merged columns
+            // that they joined may come apart again; then a dependency must
+            // also vanish along each of the pieces.
+            auto cedges = edgesOf.find(c->h.v);
+            if(cedges != edgesOf.end()) {
+                std::vector<bool> removed(edges.size(), false);
+                std::vector<int> affected;
+                for(int ei : cedges->second) {
+                    removed[ei] = true;
+                    affected.push_back(column[edges[ei].first]);
+                }
+                std::vector<int> split(n);
+                for(int j = 0; j < n; j++) split[j] = j;
+                for(size_t ei = 0; ei < edges.size(); ei++) {
+                    if(removed[ei]) continue;
+                    split[FindRoot(&split, edges[ei].first)] =
+                        FindRoot(&split, edges[ei].second);
+                }
+                std::sort(affected.begin(), affected.end());
+                affected.erase(std::unique(affected.begin(), affected.end()), affected.end());
+                for(int col : affected) {
+                    std::map<int, std::vector<int>> pieces;
+                    for(int j : members[col]) {
+                        pieces[FindRoot(&split, j)].push_back(j);
+                    }
+                    if(pieces.size() < 2) continue;
+                    for(const auto &piece : pieces) {
+                        VectorXd indicator = VectorXd::Zero(n);
+                        RowVectorXd condition = RowVectorXd::Zero(redundancy);
+                        for(int j : piece.second) {
+                            indicator[j] = 1.0;
+                            condition += W.row(j);
+                        }
+                        double norm = (mat.A.num * indicator).norm();
+                        if(EXACT(norm == 0.0)) continue;
+                        conditions.push_back(condition / norm);
+                    }
+                }
+            }
 
-            int rank = CalculateRank();
-            if(rank == mat.m) {
+            if((int)conditions.size() < redundancy) continue;
+            MatrixXd part(conditions.size(), redundancy);
+            for(size_t r = 0; r < conditions.size(); r++) {
+                part.row(r) = conditions[r];
+            }
+            JacobiSVD<MatrixXd> svd(part);
+            if(svd.singularValues()[redundancy - 1] > RANK_TOLERANCE) {
                 // We fixed it by removing this constraint
                 bad->Add(&(c->h));
             }
@@ -417,6 +1205,9 @@ void System::FindWhichToRemoveToFixJacobian(Group *g, List<hConstraint> *bad, bo
 SolveResult System::Solve(Group *g, int *rank, int *dof, List<hConstraint> *bad,
                           bool andFindBad, bool andFindFree, bool forceDofCheck)
 {
+    stats.iterations = 0;
+    stats.residual.clear();
+
     WriteEquationsExceptFor(Constraint::NO_CONSTRAINT, g);
 
     bool rankOk;
@@ -471,23 +1262,28 @@ SolveResult System::Solve(Group *g, int *rank, int *dof, List<hConstraint> *bad,
         alone++;
     }
 
-    // Now write the Jacobian for what's left, and do a rank test; that
-    // tells us if the system is inconsistently constrained.
-    if(!WriteJacobian(0)) {
-        return SolveResult::TOO_MANY_UNKNOWNS;
-    }
+    // What's left may still fall apart into subsystems that share no
+    // unknowns, like several unconnected profiles in one sketch. Each of
+    // those is solved on its own, which keeps the Jacobians small.
+    FindComponents(alone);
+
     // Clear dof value in order to have indication when dof is actually not calculated
     if(dof != NULL) *dof = -1;
-    // We are suppressing or allowing redundant, so we no need to catch unsolveable + redundant
-    rankOk = (!g->suppressDofCalculation && !g->allowRedundant) ? TestRank(dof) : true;
+    switch(SolveResult how = SolveComponents(g, dof, bad)) {
+        case SolveResult::OKAY:
+            rankOk = true;
+            break;
 
-    // And do the leftovers as one big system
-    if(!NewtonSolve(0)) {
-        goto didnt_converge;
+        case SolveResult::REDUNDANT_OKAY:
+            rankOk = false;
+            break;
+
+        case SolveResult::DIDNT_CONVERGE:
+        case SolveResult::REDUNDANT_DIDNT_CONVERGE:
+        case SolveResult::TOO_MANY_UNKNOWNS:
+            return how;
     }
 
-    // Here we are want to calculate dof even when redundant is allowed, so just handle suppressing
-    rankOk = (!g->suppressDofCalculation) ? TestRank(dof) : true;
     if(!rankOk) {
         if(andFindBad) FindWhichToRemoveToFixJacobian(g, bad, forceDofCheck);
     } else {
@@ -511,6 +1307,206 @@ SolveResult System::Solve(Group *g, int *rank, int *dof, List<hConstraint> *bad,
 
 didnt_converge:
     SK.constraint.ClearTags();
+    MarkUnsatisfiedConstraints(bad);
+    return rankOk ? SolveResult::DIDNT_CONVERGE : SolveResult::REDUNDANT_DIDNT_CONVERGE;
+}
+
+SolveResult System::SolveComponent(int tag, Group *g, int *dof) {
+    // Write the Jacobian for this subsystem, and do a rank test; that
+    // tells us if it is inconsistently constrained.
+    if(!WriteJacobian(tag, /*useCache=*/true)) {
+        return SolveResult::TOO_MANY_UNKNOWNS;
+    }
+    *dof = 0;
+    // We are suppressing or allowing redundant, so we no need to catch unsolveable + redundant
+    bool rankOk = (!g->suppressDofCalculation && !g->allowRedundant) ? TestRank(dof) : true;
+
+    if(!NewtonSolve(tag)) {
+        return rankOk ? SolveResult::DIDNT_CONVERGE : SolveResult::REDUNDANT_DIDNT_CONVERGE;
+    }
+
+    // Here we are want to calculate dof even when redundant is allowed, so just handle suppressing
+    if(!g->suppressDofCalculation) {
+        rankOk = TestRank(dof);
+    }
+    return rankOk ? SolveResult::OKAY : SolveResult::REDUNDANT_OKAY;
+}
+
+//-----------------------------------------------------------------------------
+// Solve every subsystem found by FindComponents, and combine the results as
+// if they had been solved as one big system.
+//-----------------------------------------------------------------------------
+SolveResult System::SolveComponents(Group *g, int *dof, List<hConstraint> *bad) {
+    std::vector<SolveResult> how(components);
+    std::vector<int> componentDof(components, 0);
+
+    // When solving in parallel, each subsystem gets copied into a System of
+    // its own; those are kept around until the failures are reported below.
+    std::vector<System> subsystems;
+#if !defined(__EMSCRIPTEN__)
+    int bigComponents = 0;
+    if(threads > 1 && components > 1) {
+        std::vector<int> componentEqs(components, 0);
+        for(Equation &e : eq) {
+            if(!IsComponentTag(e.tag)) continue;
+            componentEqs[e.tag - firstComponent]++;
+        }
+        for(int n : componentEqs) {
+            if(n >= PARALLEL_SIZE) bigComponents++;
+        }
+    }
+    if(bigComponents > 1) {
+        subsystems.resize(components);
+        SolveComponentsInParallel(g, &subsystems, &how, &componentDof);
+    }
+#endif
+
+    bool rankOk = true, converged = true;
+    int totalDof = 0;
+    for(int i = 0; i < components; i++) {
+        System *s = this;
+        if(subsystems.empty()) {
+            how[i] = SolveComponent(firstComponent + i, g, &componentDof[i]);
+        } else {
+            s = &subsystems[i];
+        }
+
+        if(how[i] == SolveResult::TOO_MANY_UNKNOWNS) {
+            return SolveResult::TOO_MANY_UNKNOWNS;
+        }
+        if(how[i] == SolveResult::REDUNDANT_OKAY ||
+           how[i] == SolveResult::REDUNDANT_DIDNT_CONVERGE) {
+            rankOk = false;
+        }
+        if(how[i] == SolveResult::DIDNT_CONVERGE ||
+           how[i] == SolveResult::REDUNDANT_DIDNT_CONVERGE) {
+            // Keep going, so that the unsatisfied constraints get reported
+            // for every subsystem that failed, not just the first.
+            if(converged) SK.constraint.ClearTags();
+            converged = false;
+            s->MarkUnsatisfiedConstraints(bad);
+        }
+        totalDof += componentDof[i];
+    }
+
+    if(dof != NULL && !g->suppressDofCalculation && (converged || !g->allowRedundant)) {
+        *dof = totalDof;
+    }
+    if(!converged) {
+        return rankOk ? SolveResult::DIDNT_CONVERGE : SolveResult::REDUNDANT_DIDNT_CONVERGE;
+    }
+    return rankOk ? SolveResult::OKAY : SolveResult::REDUNDANT_OKAY;
+}
+
+#if !defined(__EMSCRIPTEN__)
+//-----------------------------------------------------------------------------
+// Solve the subsystems on several threads. Each one is copied into its own
+// System, so that the threads share nothing but read-only data (the sketch,
+// and the equations themselves); the temporary Exprs that they allocate go
+// to the per-thread temporary arena, which is freed when the thread exits.
+//-----------------------------------------------------------------------------
+void System::SolveComponentsInParallel(Group *g, std::vector<System> *subsystems,
+                                       std::vector<SolveResult> *how, std::vector<int> *dof)
+{
+    std::vector<std::vector<Param *>>    componentParams(components);
+    std::vector<std::vector<Equation *>> componentEqs(components);
+    for(Param &p : param) {
+        if(!IsComponentTag(p.tag)) continue;
+        componentParams[p.tag - firstComponent].push_back(&p);
+    }
+    for(Equation &e : eq) {
+        if(!IsComponentTag(e.tag)) continue;
+        componentEqs[e.tag - firstComponent].push_back(&e);
+    }
+
+    // The threads take the subsystems from a shared queue, biggest first, so
+    // that a big one doesn't get started last and hold up everything else.
+    std::vector<int> order(components);
+    for(int i = 0; i < components; i++) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+        return componentEqs[a].size() > componentEqs[b].size();
+    });
+
+    auto solveOne = [&](int i) {
+        System *sub = &(*subsystems)[i];
+        for(Param *p : componentParams[i]) {
+            Param sp = *p;
+            sp.tag    = 0;
+            sp.substd = NULL;
+            sub->param.Add(&sp);
+        }
+        std::vector<hParam> paramsUsed;
+        for(Equation *e : componentEqs[i]) {
+            Equation se = *e;
+            se.tag = 0;
+            sub->eq.Add(&se);
+
+            // The equations may also refer to parameters outside the
+            // subsystem (like those solved alone); copy those as well, with
+            // their tags left alone so that they're held fixed.
+            paramsUsed.clear();
+            e->e->ParamsUsedList(&paramsUsed);
+            for(hParam &hp : paramsUsed) {
+                if(sub->param.FindByIdNoOops(hp) != NULL) continue;
+                Param *p = param.FindByIdNoOops(hp);
+                if(p == NULL) continue;
+                Param sp = *p;
+                sp.substd = NULL;
+                sub->param.Add(&sp);
+            }
+        }
+        for(hParam &hp : dragged) {
+            sub->dragged.Add(&hp);
+        }
+        sub->differentiation = differentiation;
+        sub->method          = method;
+        sub->sparseOnly      = sparseOnly;
+        sub->jacobianCache   = jacobianCache;
+
+        (*how)[i] = sub->SolveComponent(0, g, &(*dof)[i]);
+
+        // Each parameter belongs to exactly one subsystem, so no two threads
+        // ever write the same one.
+        for(Param *p : componentParams[i]) {
+            p->val = sub->param.FindById(p->h)->val;
+        }
+    };
+
+    std::atomic<int> next(0);
+    auto work = [&]() {
+        int k;
+        while((k = next++) < components) {
+            solveOne(order[k]);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    // Only the big subsystems are worth a thread of their own; the small ones
+    // get picked up along the way.
+    int bigComponents = 0;
+    for(const std::vector<Equation *> &eqs : componentEqs) {
+        if((int)eqs.size() >= PARALLEL_SIZE) bigComponents++;
+    }
+    int workerCount = std::min(threads, bigComponents) - 1;
+    for(int i = 0; i < workerCount; i++) {
+        workers.emplace_back(work);
+    }
+    work();
+    for(std::thread &t : workers) {
+        t.join();
+    }
+
+    for(System &sub : *subsystems) {
+        stats.iterations += sub.stats.iterations;
+        stats.residual.insert(stats.residual.end(),
+                              sub.stats.residual.begin(), sub.stats.residual.end());
+    }
+}
+#endif
+
+void System::MarkUnsatisfiedConstraints(List<hConstraint> *bad) {
     // Not using range-for here because index is used in additional ways
     for(size_t i = 0; i < mat.eq.size(); i++) {
         if(fabs(mat.B.num[i]) > CONVERGE_TOLERANCE || IsReasonable(mat.B.num[i])) {
@@ -528,8 +1524,6 @@ didnt_converge:
             }
         }
     }
-
-    return rankOk ? SolveResult::DIDNT_CONVERGE : SolveResult::REDUNDANT_DIDNT_CONVERGE;
 }
 
 SolveResult System::SolveRank(Group *g, int *rank, int *dof, List<hConstraint> *bad,
@@ -541,13 +1535,21 @@ SolveResult System::SolveRank(Group *g, int *rank, int *dof, List<hConstraint> *
     param.ClearTags();
     eq.ClearTags();
 
-    // Now write the Jacobian, and do a rank test; that
-    // tells us if the system is inconsistently constrained.
-    if(!WriteJacobian(0)) {
-        return SolveResult::TOO_MANY_UNKNOWNS;
+    // Now write the Jacobian for each independent subsystem, and do a rank
+    // test; that tells us if the system is inconsistently constrained.
+    FindComponents(1);
+    bool rankOk = true;
+    int totalDof = 0;
+    for(int tag = firstComponent; tag < firstComponent + components; tag++) {
+        if(!WriteJacobian(tag, /*useCache=*/true)) {
+            return SolveResult::TOO_MANY_UNKNOWNS;
+        }
+        int componentDof;
+        if(!TestRank(&componentDof)) rankOk = false;
+        totalDof += componentDof;
     }
+    if(dof != NULL) *dof = totalDof;
 
-    bool rankOk = TestRank(dof);
     if(!rankOk) {
         // When we are testing with redundant allowed, we don't want to have additional info
         // about redundants since this test is working only for single redundant constraint
@@ -567,25 +1569,33 @@ void System::Clear() {
     dragged.Clear();
     mat.A.num.setZero();
     mat.A.sym.setZero();
+    mat.form.reset();
+    jacobianCache.reset();
 }
 
 void System::MarkParamsFree(bool find) {
     // If requested, find all the free (unbound) variables. This might be
     // more than the number of degrees of freedom. Don't always do this,
-    // because the display would get annoying and it's slow.
+    // because the display would get annoying.
     for(auto &p : param) {
         p.free = false;
+    }
+    if(!find) return;
+
+    // A parameter can only affect the rank of its own subsystem. Without it,
+    // that Jacobian keeps its full rank exactly when the parameter moves the
+    // solution along the null space, so one factorization per subsystem
+    // finds every free parameter in it.
+    for(int tag = firstComponent; tag < firstComponent + components; tag++) {
+        if(!WriteJacobian(tag, /*useCache=*/true)) continue;
+        EvalJacobian();
 
-        if(find) {
-            if(p.tag == 0) {
-                p.tag = VAR_DOF_TEST;
-                WriteJacobian(0);
-                EvalJacobian();
-                int rank = CalculateRank();
-                if(rank == mat.m) {
-                    p.free = true;
-                }
-                p.tag = 0;
+        Eigen::SparseMatrix<double> At = mat.A.num.transpose();
+        std::vector<double> dist;
+        FindDistancesFromRange(At, &dist);
+        for(int j = 0; j < mat.n; j++) {
+            if(dist[j] > RANK_TOLERANCE) {
+                param.FindById(mat.param[j])->free = true;
             }
         }
     }
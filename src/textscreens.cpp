@@ -268,6 +268,11 @@ void TextWindow::ScreenChangeGroupOption(int link, uint32_t v) {
         case 'd': g->allDimsReference = !(g->allDimsReference); break;
 
         case 'f': g->forceToMesh = !(g->forceToMesh); break;
+
+        case 'b':
+            g->meshBoolean = (g->meshBoolean == Group::MeshBoolean::INDEXED) ?
+                Group::MeshBoolean::BSP : Group::MeshBoolean::INDEXED;
+            break;
     }
 
     SS.MarkGroupDirty(g->h);
@@ -504,6 +509,11 @@ void TextWindow::ShowGroupInfo() {
     } else {
         Printf(false, " (model already forced to triangle mesh)");
     }
+    if(g->IsForcedToMesh()) {
+        Printf(false, " %f%Lb%Fd%s  split intersecting triangles for mesh Booleans",
+            &TextWindow::ScreenChangeGroupOption,
+            g->meshBoolean == Group::MeshBoolean::INDEXED ? CHECK_TRUE : CHECK_FALSE);
+    }
 
     Printf(true, " %f%Lr%Fd%s  relax constraints and dimensions",
         &TextWindow::ScreenChangeGroupOption,
@@ -450,6 +450,9 @@ public:
     static void ScreenChangeTurntableNav(int link, uint32_t v);
     static void ScreenChangeImmediatelyEditDimension(int link, uint32_t v);
     static void ScreenChangeAutomaticLineConstraints(int link, uint32_t v);
+    static void ScreenChangeSolveInParallel(int link, uint32_t v);
+    static void ScreenChangeReverseModeJacobian(int link, uint32_t v);
+    static void ScreenChangeDampedSolver(int link, uint32_t v);
     static void ScreenChangePwlCurves(int link, uint32_t v);
     static void ScreenChangeCanvasSizeAuto(int link, uint32_t v);
     static void ScreenChangeCanvasSize(int link, uint32_t v);
@@ -831,8 +834,8 @@ public:
 
     void Invalidate(bool clearPersistent = false);
     void DrawEntities(Canvas *canvas, bool persistent);
-    void DrawPersistent(Canvas *canvas);
-    void Draw(Canvas *canvas);
+    void DrawPersistent(Canvas *canvas, bool preview);
+    void Draw(Canvas *canvas, bool preview=false);
     void Paint();
 
     bool MouseEvent(Platform::MouseEvent event);
@@ -850,6 +850,14 @@ bool VectorPred::operator()(Vector a, Vector b) const {
     return a.Equals(b, LENGTH_EPS);
 }
 
+void ContentHasher::Add(const void *data, size_t size) {
+    const uint8_t *p = (const uint8_t *)data;
+    for(size_t i = 0; i < size; i++) {
+        value ^= p[i];
+        value *= 1099511628211ull;
+    }
+}
+
 Vector4 Vector4::From(double w, double x, double y, double z) {
     Vector4 ret;
     ret.w = w;
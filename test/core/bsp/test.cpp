@@ -0,0 +1,113 @@
+#include "harness.h"
+
+static void AddBox(SMesh *m, Vector lo, Vector hi) {
+    Vector c[8];
+    for(int i = 0; i < 8; i++) {
+        c[i] = Vector::From((i & 1) ? hi.x : lo.x,
+                            (i & 2) ? hi.y : lo.y,
+                            (i & 4) ? hi.z : lo.z);
+    }
+    // Each face wound counter-clockwise, as seen from outside
+    static const int quads[6][4] = {
+        { 0, 2, 3, 1 }, { 4, 5, 7, 6 }, { 0, 1, 5, 4 },
+        { 2, 6, 7, 3 }, { 0, 4, 6, 2 }, { 1, 3, 7, 5 },
+    };
+    for(const int *q : quads) {
+        m->AddTriangle({}, c[q[0]], c[q[1]], c[q[2]]);
+        m->AddTriangle({}, c[q[0]], c[q[2]], c[q[3]]);
+    }
+}
+
+// As SMesh::MakeFromUnionOf() and MakeFromDifferenceOf(), but through BSPs
+// from the given builder; then made vertex-to-vertex, as a group would be.
+static void Combine(SMesh *out, SMesh *a, SMesh *b, bool difference,
+                    SBsp3 *(*build)(const SMesh *)) {
+    SMesh m = {};
+    m.flipNormal           = difference;
+    m.keepCoplanar         = true;
+    m.keepInsideOtherShell = difference;
+    m.AddAgainstBsp(b, build(a));
+
+    m.flipNormal           = false;
+    m.keepCoplanar         = false;
+    m.keepInsideOtherShell = false;
+    m.AddAgainstBsp(a, build(b));
+
+    SMeshBvh bvh = {};
+    bvh.MakeFromCopyOf(&m);
+    bvh.SnapToMesh(&m);
+    bvh.MakeMeshInto(out);
+    bvh.Clear();
+    m.Clear();
+}
+
+static bool IsWatertight(const SMesh *m) {
+    SMeshBvh bvh = {};
+    bvh.MakeFromCopyOf(m);
+    SEdgeList sel = {};
+    bool inters, leaks;
+    bvh.MakeCertainEdgesInto(&sel, EdgeKind::NAKED_OR_SELF_INTER,
+                             /*coplanarIsInter=*/false, &inters, &leaks);
+    sel.Clear();
+    bvh.Clear();
+    return !leaks;
+}
+
+TEST_CASE(boolean_matches_incremental) {
+    // A box with a hole through it, flush with its top and bottom; and the
+    // same box with another box unioned onto one corner, flush with its top.
+    SMesh box = {}, hole = {}, corner = {};
+    AddBox(&box,    Vector::From( 0,  0, 0), Vector::From(20, 20, 10));
+    AddBox(&hole,   Vector::From( 5,  5, 0), Vector::From(15, 15, 10));
+    AddBox(&corner, Vector::From(10, 10, 5), Vector::From(30, 30, 10));
+
+    struct {
+        SMesh *b;
+        bool   difference;
+        double volume;
+    } cases[] = {
+        { &hole,   true,  4000 - 1000       },
+        { &corner, false, 4000 + 2000 - 500 },
+    };
+    for(auto &c : cases) {
+        SMesh bulk = {}, incremental = {};
+        Combine(&bulk, &box, c.b, c.difference, SBsp3::FromMesh);
+        Combine(&incremental, &box, c.b, c.difference, SBsp3::FromMeshIncrementally);
+
+        CHECK_EQ_EPS(bulk.CalculateVolume(), c.volume);
+        CHECK_EQ_EPS(incremental.CalculateVolume(), c.volume);
+        CHECK_TRUE(IsWatertight(&bulk));
+        CHECK_TRUE(IsWatertight(&incremental));
+        bulk.Clear();
+        incremental.Clear();
+    }
+
+    box.Clear();
+    hole.Clear();
+    corner.Clear();
+    FreeAllTemporary();
+}
+
+TEST_CASE(splitter_not_sliver) {
+    // Slivers along an edge of a box, in every place that a splitter would
+    // be sampled from; the root should still be one of the box's faces.
+    SMesh faces = {}, m = {};
+    AddBox(&faces, Vector::From(0, 0, 0), Vector::From(20, 20, 10));
+    for(int i = 0; i < 32; i++) {
+        if(i % 2 == 0 || i >= 2 * faces.l.n) {
+            double x = (double)i / 2;
+            m.AddTriangle({}, Vector::From(x, 0, 0), Vector::From(x + 0.5, 1e-9, 0),
+                              Vector::From(x + 1, 0, 0));
+        } else {
+            m.AddTriangle(&faces.l[i / 2]);
+        }
+    }
+
+    SBsp3 *bsp = SBsp3::FromMesh(&m);
+    CHECK_TRUE(bsp != NULL);
+    CHECK_TRUE(bsp->tri.Normal().Magnitude() >= LENGTH_EPS);
+
+    faces.Clear();
+    m.Clear();
+    FreeAllTemporary();
+}
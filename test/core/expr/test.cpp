@@ -110,3 +110,63 @@ TEST_CASE(errors) {
   CHECK_PARSE_ERR("(",
                   "Expected ')'");
 }
+
+static Expr *ParamPtr(Param *p) {
+  Expr *e = Expr::AllocExpr();
+  e->op = Expr::Op::PARAM_PTR;
+  e->parp = p;
+  return e;
+}
+
+TEST_CASE(tape) {
+  Param px = {}, py = {};
+  px.val = 3;
+  py.val = 4;
+  Expr *x = ParamPtr(&px), *y = ParamPtr(&py);
+  Expr *r2 = (x->Square())->Plus(y->Square());
+  Expr *e = (r2->Sqrt())->Plus(r2->Div(x->Times(y)))->Minus((y->Times(x))->Sin());
+
+  ExprTape tape = {};
+  int re = tape.Compile(e);
+  int rr2 = tape.Compile(r2->DeepCopy());
+  // r2 and x*y == y*x are shared, so there are two loads and nine ops.
+  CHECK_TRUE(rr2 != re);
+  CHECK_TRUE(tape.code.size() == 11);
+
+  tape.Eval();
+  CHECK_TRUE(tape.Value(re) == e->Eval());
+  CHECK_TRUE(tape.Value(rr2) == 25);
+
+  px.val = -1.5;
+  tape.Eval();
+  CHECK_TRUE(tape.Value(re) == e->Eval());
+}
+
+TEST_CASE(tape_backprop) {
+  Param px = {}, py = {};
+  px.h.v = 1;
+  py.h.v = 2;
+  px.val = 0.3;
+  py.val = 2;
+  Expr *x = ParamPtr(&px), *y = ParamPtr(&py);
+  Expr *e = (x->Times(x)->Div(y))->Minus((x->ASin())->Times(y->Cos()))
+                ->Plus((x->Negate()->Minus(y))->Square()->Sqrt());
+
+  ExprTape tape = {};
+  int re = tape.Compile(e);
+  int rx = tape.Compile(x), ry = tape.Compile(y);
+  std::vector<int> deps;
+  tape.Dependencies(re, &deps);
+  CHECK_TRUE(deps.size() == tape.code.size());
+
+  tape.Eval();
+  std::vector<double> adj(tape.reg.size(), 0.0);
+  tape.Backprop(re, deps, adj.data());
+  CHECK_EQ_EPS(adj[rx], e->PartialWrt(px.h)->Eval());
+  CHECK_EQ_EPS(adj[ry], e->PartialWrt(py.h)->Eval());
+
+  // Only what y*y depends on.
+  int ryy = tape.Compile(y->Times(y));
+  tape.Dependencies(ryy, &deps);
+  CHECK_TRUE(deps.size() == 2);
+}
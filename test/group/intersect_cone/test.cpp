@@ -0,0 +1,32 @@
+#include "harness.h"
+
+TEST_CASE(normal_roundtrip) {
+    CHECK_LOAD("normal.slvs");
+    CHECK_SAVE("normal.slvs");
+}
+
+TEST_CASE(normal_volume) {
+    CHECK_LOAD("normal.slvs");
+
+    // A cone of radius 10 mm and height 20 mm, lathed about the y axis, with
+    // a box cutting off its top half; the box's face is normal to the axis,
+    // so it meets the cone in an arc. That leaves a frustum.
+    double expected = PI*10/3*(10*10 + 10*5 + 5*5);
+
+    Group *g = SK.GetGroup(SS.GW.activeGroup);
+    g->GenerateDisplayItems();
+    SMesh *m = &g->displayMesh;
+    // Within what the chord tolerance allows
+    CHECK_TRUE(fabs(m->CalculateVolume() - expected) < 0.01*expected);
+
+    SMeshBvh bvh = {};
+    bvh.MakeFromCopyOf(m);
+    SEdgeList sel = {};
+    bool inters, leaks;
+    bvh.MakeCertainEdgesInto(&sel, EdgeKind::NAKED_OR_SELF_INTER,
+                             /*coplanarIsInter=*/false, &inters, &leaks);
+    CHECK_TRUE(!leaks);
+    CHECK_TRUE(!inters);
+    sel.Clear();
+    bvh.Clear();
+}
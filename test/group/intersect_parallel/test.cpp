@@ -0,0 +1,33 @@
+#include "harness.h"
+
+TEST_CASE(normal_roundtrip) {
+    CHECK_LOAD("normal.slvs");
+    CHECK_SAVE("normal.slvs");
+}
+
+TEST_CASE(normal_volume) {
+    CHECK_LOAD("normal.slvs");
+
+    // Two cylinders of radius 10 mm and length 20 mm, along z, with their
+    // axes 15 mm apart; so they meet in two lines, and the union is twice
+    // a cylinder, less the lens-shaped region they share.
+    double lens = 2*10*10*acos(15.0/20) - 7.5*sqrt(20*20 - 15*15);
+    double expected = (2*PI*10*10 - lens)*20;
+
+    Group *g = SK.GetGroup(SS.GW.activeGroup);
+    g->GenerateDisplayItems();
+    SMesh *m = &g->displayMesh;
+    // Within what the chord tolerance allows
+    CHECK_TRUE(fabs(m->CalculateVolume() - expected) < 0.01*expected);
+
+    SMeshBvh bvh = {};
+    bvh.MakeFromCopyOf(m);
+    SEdgeList sel = {};
+    bool inters, leaks;
+    bvh.MakeCertainEdgesInto(&sel, EdgeKind::NAKED_OR_SELF_INTER,
+                             /*coplanarIsInter=*/false, &inters, &leaks);
+    CHECK_TRUE(!leaks);
+    CHECK_TRUE(!inters);
+    sel.Clear();
+    bvh.Clear();
+}
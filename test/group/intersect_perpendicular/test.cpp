@@ -0,0 +1,35 @@
+#include "harness.h"
+
+TEST_CASE(normal_roundtrip) {
+    CHECK_LOAD("normal.slvs");
+    CHECK_SAVE("normal.slvs");
+}
+
+TEST_CASE(normal_volume) {
+    CHECK_LOAD("normal.slvs");
+
+    // A cylinder of radius 10 mm and length 20 mm along z, unioned with one
+    // of radius 5 mm and length 40 mm along x, so that the thinner one goes
+    // right through the thicker. They share the integral of
+    // 4*sqrt(10^2 - y^2)*sqrt(5^2 - y^2) over -5 <= y <= 5, which is elliptic,
+    // so that's found numerically here.
+    double shared = 1520.039988;
+    double expected = PI*10*10*20 + PI*5*5*40 - shared;
+
+    Group *g = SK.GetGroup(SS.GW.activeGroup);
+    g->GenerateDisplayItems();
+    SMesh *m = &g->displayMesh;
+    // Within what the chord tolerance allows
+    CHECK_TRUE(fabs(m->CalculateVolume() - expected) < 0.01*expected);
+
+    SMeshBvh bvh = {};
+    bvh.MakeFromCopyOf(m);
+    SEdgeList sel = {};
+    bool inters, leaks;
+    bvh.MakeCertainEdgesInto(&sel, EdgeKind::NAKED_OR_SELF_INTER,
+                             /*coplanarIsInter=*/false, &inters, &leaks);
+    CHECK_TRUE(!leaks);
+    CHECK_TRUE(!inters);
+    sel.Clear();
+    bvh.Clear();
+}
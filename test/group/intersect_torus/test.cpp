@@ -0,0 +1,34 @@
+#include "harness.h"
+
+TEST_CASE(normal_roundtrip) {
+    CHECK_LOAD("normal.slvs");
+    CHECK_SAVE("normal.slvs");
+}
+
+TEST_CASE(normal_volume) {
+    CHECK_LOAD("normal.slvs");
+
+    // A torus lathed from a circle of radius 5 mm, 15 mm from the y axis,
+    // with a box cutting off everything above y = 2 mm; so the plane is
+    // normal to the axis, and meets the torus in two circles. What's left is
+    // the lathe of the circle less its segment above y = 2 mm.
+    double segment = 5*5*acos(2.0/5) - 2*sqrt(5*5 - 2*2);
+    double expected = 2*PI*15*(PI*5*5 - segment);
+
+    Group *g = SK.GetGroup(SS.GW.activeGroup);
+    g->GenerateDisplayItems();
+    SMesh *m = &g->displayMesh;
+    // Within what the chord tolerance allows
+    CHECK_TRUE(fabs(m->CalculateVolume() - expected) < 0.01*expected);
+
+    SMeshBvh bvh = {};
+    bvh.MakeFromCopyOf(m);
+    SEdgeList sel = {};
+    bool inters, leaks;
+    bvh.MakeCertainEdgesInto(&sel, EdgeKind::NAKED_OR_SELF_INTER,
+                             /*coplanarIsInter=*/false, &inters, &leaks);
+    CHECK_TRUE(!leaks);
+    CHECK_TRUE(!inters);
+    sel.Clear();
+    bvh.Clear();
+}
@@ -0,0 +1,38 @@
+#include "harness.h"
+
+TEST_CASE(normal_roundtrip) {
+    CHECK_LOAD("normal.slvs");
+    CHECK_SAVE("normal.slvs");
+}
+
+TEST_CASE(normal_merge) {
+    CHECK_LOAD("normal.slvs");
+
+    // A box, with a box 0.01 mm wide unioned onto one side, far enough from
+    // the origin that the narrow faces' planes are poorly determined.
+    Group *g = SK.GetGroup(SS.GW.activeGroup);
+    SShell *sh = &g->runningShell;
+
+    // Every coplanar face should have been merged, as if each surface had
+    // been tested against every other one; so what's left is one box.
+    int faces = 0, mergeable = 0;
+    for(SSurface &si : sh->surface) {
+        if(si.trim.IsEmpty() || si.degm != 1 || si.degn != 1) continue;
+        faces++;
+        SEdgeList sel = {};
+        si.MakeEdgesInto(sh, &sel, SSurface::MakeAs::XYZ);
+        for(SSurface &sj : sh->surface) {
+            if(&sj == &si || sj.trim.IsEmpty()) continue;
+            if(sj.degm != 1 || sj.degn != 1) continue;
+            if(!sj.CoincidentWith(&si, /*sameNormal=*/true)) continue;
+            if(!sj.color.Equals(si.color)) continue;
+            SEdgeList tel = {};
+            sj.MakeEdgesInto(sh, &tel, SSurface::MakeAs::XYZ);
+            if(sel.ContainsEdgeFrom(&tel)) mergeable++;
+            tel.Clear();
+        }
+        sel.Clear();
+    }
+    CHECK_TRUE(mergeable == 0);
+    CHECK_TRUE(faces == 6);
+}
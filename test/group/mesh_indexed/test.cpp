@@ -0,0 +1,81 @@
+#include "harness.h"
+
+TEST_CASE(normal_roundtrip) {
+    CHECK_LOAD("normal.slvs");
+    CHECK_SAVE("normal.slvs");
+}
+
+TEST_CASE(normal_boolean) {
+    CHECK_LOAD("normal.slvs");
+
+    // A 20x20 mm box, forced to mesh, with a 10x10 mm hole cut through it
+    // by the indexed mesh Boolean; the hole's caps are coplanar with the
+    // box's, so the classification sees every case.
+    Group *g = SK.GetGroup(SS.GW.activeGroup);
+    CHECK_TRUE(g->meshBoolean == Group::MeshBoolean::INDEXED);
+    double box = g->RunningMeshGroup()->runningMesh.CalculateVolume();
+    CHECK_TRUE(box > 0);
+
+    SMesh *m = &g->runningMesh;
+    double volume = m->CalculateVolume();
+    CHECK_TRUE(fabs(volume - 0.75*box) < 1e-6);
+
+    SMeshBvh bvh = {};
+    bvh.MakeFromCopyOf(m);
+    SEdgeList sel = {};
+    bool inters, leaks;
+    bvh.MakeCertainEdgesInto(&sel, EdgeKind::NAKED_OR_SELF_INTER,
+                             /*coplanarIsInter=*/false, &inters, &leaks);
+    CHECK_TRUE(!leaks);
+    CHECK_TRUE(!inters);
+    sel.Clear();
+    bvh.Clear();
+
+    // And the same solid as the BSP would have made.
+    g->meshBoolean = Group::MeshBoolean::BSP;
+    SS.MarkGroupDirty(g->h);
+    SS.GenerateAll(SolveSpaceUI::Generate::ALL);
+    CHECK_TRUE(fabs(g->runningMesh.CalculateVolume() - volume) < 1e-6);
+}
+
+TEST_CASE(normal_compact) {
+    CHECK_LOAD("normal.slvs");
+
+    // The result of the Boolean has vertices shared between many triangles,
+    // and triangles of several faces.
+    SMesh *m = &SK.GetGroup(SS.GW.activeGroup)->runningMesh;
+    std::vector<uint32_t> faces;
+    for(const STriangle &tr : m->l) {
+        if(std::find(faces.begin(), faces.end(), tr.meta.face) == faces.end()) {
+            faces.push_back(tr.meta.face);
+        }
+    }
+
+    for(bool exact : { true, false }) {
+        SCompactMesh cm = {};
+        cm.MakeFromCopyOf(m, exact);
+        CHECK_TRUE(cm.triangles.size() == (size_t)m->l.n);
+        CHECK_TRUE(cm.VertexCount() < 3 * cm.triangles.size());
+
+        SMesh rm = {};
+        cm.MakeMeshInto(&rm);
+        CHECK_TRUE(rm.l.n == m->l.n);
+        for(int i = 0; i < m->l.n; i++) {
+            const STriangle &a = m->l[i], &b = rm.l[i];
+            CHECK_TRUE(a.meta.face == b.meta.face);
+            CHECK_TRUE(a.meta.color.Equals(b.meta.color));
+            for(int j = 0; j < 3; j++) {
+                if(exact) {
+                    CHECK_TRUE(a.vertices[j].EqualsExactly(b.vertices[j]));
+                    CHECK_TRUE(a.normals[j].EqualsExactly(b.normals[j]));
+                } else {
+                    CHECK_TRUE(a.vertices[j].Equals(b.vertices[j]));
+                }
+            }
+        }
+        CHECK_EQ_EPS(rm.CalculateVolume(), m->CalculateVolume());
+        CHECK_EQ_EPS(rm.CalculateSurfaceArea(faces), m->CalculateSurfaceArea(faces));
+        rm.Clear();
+        cm.Clear();
+    }
+}
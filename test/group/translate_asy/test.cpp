@@ -20,8 +20,11 @@ TEST_CASE(normal_inters) {
 
     SEdgeList el = {};
     bool inters, leaks;
-    SKdNode::From(m)->MakeCertainEdgesInto(&el,
+    SMeshBvh bvh = {};
+    bvh.MakeFromCopyOf(m);
+    bvh.MakeCertainEdgesInto(&el,
         EdgeKind::SELF_INTER, /*coplanarIsInter=*/false, &inters, &leaks);
+    bvh.Clear();
     el.Clear();
 
     // The assembly is supposed to interfere.
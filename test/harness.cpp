@@ -338,11 +338,17 @@ int main(int argc, char **argv) {
     std::vector<std::string> args = Platform::InitCli(argc, argv);
 
     std::regex filter(".*");
+    bool reverseModeJacobian = false;
+    if(args.size() > 1 && args[1] == "--reverse-mode-jacobian") {
+        reverseModeJacobian = true;
+        args.erase(args.begin() + 1);
+    }
     if(args.size() == 1) {
     } else if(args.size() == 2) {
         filter = args[1];
     } else {
-        fprintf(stderr, "Usage: %s [test filter regex]\n", args[0].c_str());
+        fprintf(stderr, "Usage: %s [--reverse-mode-jacobian] [test filter regex]\n",
+                args[0].c_str());
         return 1;
     }
 
@@ -368,6 +374,7 @@ int main(int argc, char **argv) {
         SS.Init();
         SS.showToolbar = false;
         SS.checkClosedContour = false;
+        SS.reverseModeJacobian = reverseModeJacobian;
 
         Test::Helper helper = {};
         testCase.fn(&helper);